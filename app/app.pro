@@ -0,0 +1,15 @@
+QT += widgets core network
+requires(qtConfig(filedialog))
+TARGET = application
+
+include(../src/src.pri)
+
+HEADERS       =
+SOURCES       = main.cpp
+#! [0]
+#RESOURCES     = application.qrc
+#! [0]
+
+# install
+target.path = $$[QT_INSTALL_EXAMPLES]/widgets/mainwindows/application
+INSTALLS += target
@@ -0,0 +1,249 @@
+#include "mainwindow.h"
+#include "perf.h"
+
+#include <QApplication>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFileOpenEvent>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QSettings>
+#include <QTimer>
+#include <QWindow>
+
+#include <memory>
+
+// Custom QApplication to handle QFileOpenEvent globally
+class TextEditorApp : public QApplication {
+    Q_OBJECT
+
+public:
+    TextEditorApp(int &argc, char **argv) : QApplication(argc, argv), mainWindow(nullptr) {}
+
+    void setMainWindow(MainWindow *window) {
+        mainWindow = window;
+    }
+
+protected:
+    bool event(QEvent *event) override {
+        if (event->type() == QEvent::FileOpen) {
+            QFileOpenEvent *fileOpenEvent = static_cast<QFileOpenEvent *>(event);
+            QString filePath = fileOpenEvent->file();
+            if (!filePath.isEmpty() && mainWindow) { // Corrected from isValid() to isEmpty()
+                mainWindow->openFileFromEvent(filePath);
+                return true;
+            }
+        }
+
+        return QApplication::event(event);
+    }
+
+private:
+    MainWindow *mainWindow;
+};
+
+// Single instance
+// The first instance listens on a local socket named after the user. Later launches send it
+// their files, one absolute path per line, and exit; an empty list just raises the window.
+// The name is spelled out because the hand-off runs before there is a QCoreApplication.
+static const char applicationName[] = "Mactext";
+
+static QString instanceServerName() {
+    return QString("%1-%2").arg(QLatin1String(applicationName), qEnvironmentVariable("USER"));
+}
+
+static bool handOffToRunningInstance(const QStringList &files) {
+    QLocalSocket socket;
+    socket.connectToServer(instanceServerName());
+    if (!socket.waitForConnected(200))
+        return false;
+
+    QByteArray message;
+    for (const QString &file : files) {
+        message += QFileInfo(file).absoluteFilePath().toUtf8() + '\n';
+    }
+    socket.write(message);
+    // Disconnecting flushes the pending write first
+    socket.disconnectFromServer();
+    if (socket.state() != QLocalSocket::UnconnectedState) {
+        socket.waitForDisconnected(1000);
+    }
+    return true;
+}
+
+class InstanceServer : public QObject {
+    Q_OBJECT
+
+public:
+    InstanceServer(QObject *parent = nullptr);
+    // A stale socket left by a crashed instance is only replaced when asked to
+    bool listen(bool replaceStale = false);
+
+signals:
+    void filesReceived(const QStringList &files);
+
+private slots:
+    void acceptConnections();
+
+private:
+    QLocalServer server;
+};
+
+InstanceServer::InstanceServer(QObject *parent) : QObject(parent) {
+    // Other users on the machine can't hand files to this instance
+    server.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&server, &QLocalServer::newConnection, this, &InstanceServer::acceptConnections);
+}
+
+bool InstanceServer::listen(bool replaceStale) {
+    if (server.listen(instanceServerName()))
+        return true;
+    if (!replaceStale)
+        return false;
+    QLocalServer::removeServer(instanceServerName());
+    return server.listen(instanceServerName());
+}
+
+void InstanceServer::acceptConnections() {
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+        std::shared_ptr<QByteArray> message = std::make_shared<QByteArray>();
+        connect(socket, &QLocalSocket::readyRead, this, [socket, message]() {
+            message->append(socket->readAll());
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket, message]() {
+            message->append(socket->readAll());
+            QStringList files;
+            for (const QByteArray &line : message->split('\n')) {
+                if (!line.isEmpty())
+                    files.append(QString::fromUtf8(line));
+            }
+            socket->deleteLater();
+            emit filesReceived(files);
+        });
+    }
+}
+
+// Time to first frame
+// Started at the top of main() and stopped once the main window has first been exposed
+// and flushed. Logged with --measure-startup, which also quits right after.
+class FirstFrameTimer : public QObject {
+public:
+    FirstFrameTimer(const QElapsedTimer &launch, bool quitAfter, QObject *parent = nullptr)
+        : QObject(parent), launch(launch), quitAfter(quitAfter) {}
+
+    qint64 elapsed = -1;    // Milliseconds, once the first frame is out
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override {
+        if (event->type() == QEvent::Expose && static_cast<QWindow*>(watched)->isExposed()) {
+            watched->removeEventFilter(this);
+            // Zero timers run after the expose has been painted and flushed
+            QTimer::singleShot(0, this, [this]() {
+                elapsed = launch.elapsed();
+                if (PerfRecorder::isRecording()) {
+                    PerfRecorder &recorder = PerfRecorder::instance();
+                    qint64 duration = launch.nsecsElapsed();
+                    recorder.add("startup.firstFrame", qMax<qint64>(0, recorder.now() - duration), duration);
+                }
+                if (quitAfter) {
+                    qInfo("First frame after %lld ms", elapsed);
+                    QCoreApplication::quit();
+                }
+            });
+        }
+        return false;
+    }
+
+private:
+    QElapsedTimer launch;
+    bool quitAfter;
+};
+
+// Main function
+// Options main() understands; any other argument starting with -- is ignored rather than
+// opened as a file
+static bool isKnownOption(const QString &arg) {
+    static const QStringList options = {"--measure-startup", "--new-instance"};
+    return options.contains(arg);
+}
+
+int main(int argc, char *argv[]) {
+    QElapsedTimer launchTimer;
+    launchTimer.start();
+
+    // Hand the files to a running instance before paying for QApplication. A known option
+    // (--measure-startup, --new-instance) keeps this launch in its own process.
+    QStringList launchFiles;
+    bool ownProcess = false;
+    for (int i = 1; i < argc; ++i) {
+        QString arg = QString::fromLocal8Bit(argv[i]);
+        if (isKnownOption(arg))
+            ownProcess = true;
+        else if (arg.startsWith("--"))
+            qWarning() << "Ignoring unknown option" << arg;
+        else
+            launchFiles.append(arg);
+    }
+    if (!ownProcess && handOffToRunningInstance(launchFiles))
+        return 0;
+
+    TextEditorApp app(argc, argv);
+    app.setOrganizationName(applicationName);
+    app.setApplicationName(applicationName);
+
+    // For field data: set perf/recordAtLaunch to capture startup as well
+    if (QSettings().value("perf/recordAtLaunch", false).toBool()) {
+        PerfRecorder::instance().setRecording(true);
+    }
+
+    MainWindow mainWindow;
+    app.setMainWindow(&mainWindow);
+
+    InstanceServer instanceServer;
+    if (!ownProcess && !instanceServer.listen()) {
+        // Another instance may have started listening since the first attempt
+        if (handOffToRunningInstance(launchFiles))
+            return 0;
+        instanceServer.listen(true);
+    }
+    QObject::connect(&instanceServer, &InstanceServer::filesReceived, &mainWindow,
+                     [&mainWindow](const QStringList &files) {
+        for (const QString &file : files) {
+            mainWindow.openFileFromEvent(file);
+        }
+        mainWindow.raise();
+        mainWindow.activateWindow();
+    });
+
+
+    // If files are passed as command-line arguments, open them
+    QStringList args = app.arguments();
+    bool measureStartup = args.removeAll("--measure-startup") > 0;
+    bool newInstance = args.removeAll("--new-instance") > 0;
+
+    // Recovered edits come first, so the session and the arguments don't open those files again.
+    // A second instance leaves the session to the first one.
+    mainWindow.recoverJournals();
+    if (!newInstance) {
+        mainWindow.restoreSession();
+    }
+
+    for (int i = 1; i < args.size(); ++i) { // Skip the first argument (application path)
+        if (!args.at(i).startsWith("--"))
+            mainWindow.openFileFromEvent(args.at(i));
+    }
+
+    // Finder open events arrive once the event loop runs and replace this if it is still empty
+    mainWindow.openStartupDocument();
+    mainWindow.show();
+
+    FirstFrameTimer firstFrame(launchTimer, measureStartup);
+    mainWindow.windowHandle()->installEventFilter(&firstFrame);
+
+    return app.exec();
+}
+
+#include "main.moc"
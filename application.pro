@@ -1,12 +1,7 @@
-QT += widgets core
+TEMPLATE = subdirs
 requires(qtConfig(filedialog))
 
-HEADERS       =
-SOURCES       = main.cpp
-#! [0]
-#RESOURCES     = application.qrc
-#! [0]
-
-# install
-target.path = $$[QT_INSTALL_EXAMPLES]/widgets/mainwindows/application
-INSTALLS += target
+# The editor is built once as a static library and linked into the app and the benchmarks
+SUBDIRS = src app benchmarks
+app.depends = src
+benchmarks.depends = src
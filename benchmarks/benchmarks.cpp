@@ -0,0 +1,330 @@
+#include "codeeditor.h"
+#include "highlighter.h"
+#include "jobs.h"
+#include "mainwindow.h"
+#include "search.h"
+
+#include <QApplication>
+#include <QFile>
+#include <QHash>
+#include <QRegularExpression>
+#include <QScrollBar>
+#include <QSyntaxHighlighter>
+#include <QTabWidget>
+#include <QTemporaryDir>
+#include <QTextBlock>
+#include <QTest>
+#include <QTextDocument>
+#include <QTextStream>
+
+#include <memory>
+
+// Reference copy of the original highlighter, which rebuilt its patterns for every block.
+class PerBlockRegexHighlighter : public QSyntaxHighlighter {
+public:
+    PerBlockRegexHighlighter(QTextDocument *parent = nullptr) : QSyntaxHighlighter(parent) {}
+
+protected:
+    void highlightBlock(const QString &text) override {
+        QRegularExpression keywordPattern("\\b(if|else|for|while|int|double|QString|return|void|class|public|private|protected|include)\\b");
+        QTextCharFormat keywordFormat;
+        keywordFormat.setForeground(Qt::blue);
+        keywordFormat.setFontWeight(QFont::Bold);
+        QRegularExpressionMatchIterator i = keywordPattern.globalMatch(text);
+        while (i.hasNext()) {
+            QRegularExpressionMatch match = i.next();
+            setFormat(match.capturedStart(), match.capturedLength(), keywordFormat);
+        }
+
+        QRegularExpression stringPattern("\".*?\"");
+        QTextCharFormat stringFormat;
+        stringFormat.setForeground(Qt::darkGreen);
+        QRegularExpressionMatchIterator j = stringPattern.globalMatch(text);
+        while (j.hasNext()) {
+            QRegularExpressionMatch match = j.next();
+            setFormat(match.capturedStart(), match.capturedLength(), stringFormat);
+        }
+
+        QRegularExpression commentPattern("//[^\n]*");
+        QTextCharFormat commentFormat;
+        commentFormat.setForeground(Qt::gray);
+        QRegularExpressionMatchIterator k = commentPattern.globalMatch(text);
+        while (k.hasNext()) {
+            QRegularExpressionMatch match = k.next();
+            setFormat(match.capturedStart(), match.capturedLength(), commentFormat);
+        }
+    }
+};
+
+static QString generateBenchmarkSource(int lines) {
+    QString source;
+    QTextStream out(&source);
+    for (int i = 0; i < lines; ++i) {
+        switch (i % 4) {
+        case 0: out << "int value" << i << " = compute(" << i << "); // generated\n"; break;
+        case 1: out << "if (value > 0) { return QString(\"line " << i << "\"); }\n"; break;
+        case 2: out << "for (int j = 0; j < " << i << "; ++j) total += j;\n"; break;
+        default: out << "void method" << i << "() { while (running) step(); }\n"; break;
+        }
+    }
+    return source;
+}
+
+// Drops the tokens SyntaxHighlighter caches per block, so the next pass lexes everything again
+static void clearBlockData(QTextDocument &document) {
+    for (QTextBlock block = document.begin(); block.isValid(); block = block.next())
+        block.setUserData(nullptr);
+}
+
+// Benchmarks
+// highlight and search compare the current code against what it replaced on generated C++;
+// suite drives a real MainWindow over generated files of 2k, 100k and 1M lines. Rows of
+// suite are named size/operation and run in order, so one window serves a whole size.
+class Benchmarks : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void highlight_data();
+    void highlight();
+    void search_data();
+    void search();
+    void suite_data();
+    void suite();
+
+private:
+    // Generated text of this many lines, built once
+    const QString &source(int lines);
+    void openSuiteWindow(int lines);
+    void loadSuiteFile();
+    void closeSuiteWindow();
+
+    QHash<int, QString> sources;
+    QTemporaryDir directory;
+
+    std::unique_ptr<MainWindow> suiteWindow;
+    CodeEditor *suiteEditor = nullptr;
+    QString suiteFile;
+    int suiteLines = 0;     // Size the window has open, or 0
+};
+
+void Benchmarks::initTestCase() {
+    QVERIFY(directory.isValid());
+}
+
+void Benchmarks::cleanupTestCase() {
+    closeSuiteWindow();
+}
+
+const QString &Benchmarks::source(int lines) {
+    auto it = sources.find(lines);
+    if (it == sources.end())
+        it = sources.insert(lines, generateBenchmarkSource(lines));
+    return *it;
+}
+
+void Benchmarks::highlight_data() {
+    QTest::addColumn<bool>("lexer");
+
+    QTest::newRow("per-block regex") << false;
+    QTest::newRow("single-pass lexer") << true;
+}
+
+void Benchmarks::highlight() {
+    QFETCH(bool, lexer);
+
+    QTextDocument document;
+    document.setPlainText(source(200000));
+    std::unique_ptr<QSyntaxHighlighter> highlighter;
+    if (lexer)
+        highlighter = std::make_unique<SyntaxHighlighter>(&document, LanguageRegistry::instance().defaultLanguage());
+    else
+        highlighter = std::make_unique<PerBlockRegexHighlighter>(&document);
+
+    QBENCHMARK {
+        clearBlockData(document);
+        highlighter->rehighlight();
+    }
+}
+
+void Benchmarks::search_data() {
+    QTest::addColumn<bool>("kernel");
+    QTest::addColumn<bool>("caseSensitive");
+
+    QTest::newRow("QString::indexOf, case-sensitive") << false << true;
+    QTest::newRow("literal kernel, case-sensitive") << true << true;
+    QTest::newRow("QString::indexOf, case-insensitive") << false << false;
+    QTest::newRow("literal kernel, case-insensitive") << true << false;
+}
+
+void Benchmarks::search() {
+    QFETCH(bool, kernel);
+    QFETCH(bool, caseSensitive);
+
+    const QString needle = "QString";
+    const QString &content = source(2000000);
+    const Qt::CaseSensitivity sensitivity = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+    qsizetype matches = 0;
+    QBENCHMARK {
+        matches = 0;
+        if (kernel) {
+            LiteralSearcher searcher(needle, sensitivity);
+            for (qsizetype pos = searcher.indexIn(content); pos != -1; pos = searcher.indexIn(content, pos + needle.size()))
+                ++matches;
+        } else {
+            for (qsizetype pos = content.indexOf(needle, 0, sensitivity); pos != -1;
+                 pos = content.indexOf(needle, pos + needle.size(), sensitivity)) {
+                ++matches;
+            }
+        }
+    }
+    // Every fourth line holds the needle once
+    QCOMPARE(matches, qsizetype(2000000 / 4));
+}
+
+void Benchmarks::suite_data() {
+    QTest::addColumn<int>("lines");
+    QTest::addColumn<QString>("operation");
+
+    const QList<QPair<QString, int>> sizes = {{"small", 2000}, {"medium", 100000}, {"huge", 1000000}};
+    // Replace all comes last since it changes the document
+    const QStringList operations = {"load", "highlight", "scroll-paint", "find", "save", "replace-all"};
+    for (const auto &[size, lines] : sizes) {
+        for (const QString &operation : operations) {
+            QTest::newRow(qPrintable(size + '/' + operation)) << lines << operation;
+        }
+    }
+}
+
+void Benchmarks::suite() {
+    QFETCH(int, lines);
+    QFETCH(QString, operation);
+
+    // Pages painted by the scroll benchmark at most
+    const int maxFrames = 300;
+    const QString needle = "QString";
+
+    // Highlight: a synchronous full pass of the default lexer over the same text
+    if (operation == "highlight") {
+        QTextDocument document;
+        document.setPlainText(source(lines));
+        SyntaxHighlighter highlighter(&document);
+        QBENCHMARK {
+            clearBlockData(document);
+            highlighter.rehighlight();
+        }
+        return;
+    }
+
+    // Load: until the streaming loader makes the editor writable
+    if (operation == "load" || suiteLines != lines) {
+        openSuiteWindow(lines);
+        if (QTest::currentTestFailed())
+            return;
+        if (operation == "load") {
+            QBENCHMARK_ONCE {
+                loadSuiteFile();
+            }
+        } else {
+            loadSuiteFile();
+        }
+        QVERIFY2(suiteEditor, qPrintable("Could not open " + suiteFile));
+        if (operation == "load")
+            return;
+    }
+
+    if (operation == "scroll-paint") {
+        // One synchronous repaint of the window per page
+        QScrollBar *scrollBar = suiteEditor->verticalScrollBar();
+        const int frames = qMax(1, qMin(maxFrames, scrollBar->maximum() / qMax(1, scrollBar->pageStep()) + 1));
+        QBENCHMARK {
+            for (int frame = 0; frame < frames; ++frame) {
+                scrollBar->setValue(frame * scrollBar->pageStep());
+                QCoreApplication::sendPostedEvents();
+                suiteWindow->repaint();
+            }
+        }
+    } else if (operation == "find") {
+        // Building the match index the find dialog steps through
+        SearchIndex *index = suiteEditor->searchIndex();
+        QBENCHMARK {
+            index->setQuery(SearchQuery(needle, SearchOptions()), suiteEditor->snapshot().text());
+        }
+        QVERIFY(index->count() > 0);
+    } else if (operation == "save") {
+        // Before replacing, so every size writes the generated text
+        const QString savedName = directory.filePath(QString("%1-saved.cpp").arg(lines));
+        bool saved = true;
+        QBENCHMARK {
+            SaveJob job(suiteEditor->snapshot(), savedName);
+            job.run();
+            saved = saved && job.ok;
+        }
+        QVERIFY2(saved, qPrintable("Could not save " + savedName));
+    } else if (operation == "replace-all") {
+        SearchOptions sensitive;
+        sensitive.caseSensitive = true;
+        int replaced = 0;
+        QBENCHMARK_ONCE {
+            replaced = suiteEditor->replaceAll(SearchQuery(needle, sensitive), "QStringView");
+        }
+        QVERIFY(replaced > 0);
+        // The text no longer matches the file, so the next size starts from a fresh window
+        closeSuiteWindow();
+    } else {
+        QFAIL(qPrintable("Unknown operation " + operation));
+    }
+}
+
+void Benchmarks::openSuiteWindow(int lines) {
+    closeSuiteWindow();
+
+    suiteFile = directory.filePath(QString("%1.cpp").arg(lines));
+    if (!QFile::exists(suiteFile)) {
+        QFile file(suiteFile);
+        QVERIFY2(file.open(QIODevice::WriteOnly) && file.write(source(lines).toUtf8()) >= 0,
+                 qPrintable("Could not write " + suiteFile));
+    }
+
+    suiteWindow = std::make_unique<MainWindow>();
+    suiteWindow->setJournalRoot(directory.filePath("journal"));
+    suiteWindow->resize(1024, 768);
+    suiteWindow->show();
+    suiteLines = lines;
+}
+
+void Benchmarks::loadSuiteFile() {
+    suiteWindow->openFileFromEvent(suiteFile);
+    suiteEditor = qobject_cast<CodeEditor*>(suiteWindow->findChild<QTabWidget*>()->currentWidget());
+    while (suiteEditor && suiteEditor->isReadOnly()) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    }
+}
+
+void Benchmarks::closeSuiteWindow() {
+    // Drop the edits so the window closes without asking
+    if (suiteEditor)
+        suiteEditor->document()->setModified(false);
+    suiteEditor = nullptr;
+    suiteWindow.reset();
+    suiteLines = 0;
+}
+
+int main(int argc, char *argv[]) {
+    // Runs headless unless a platform was picked explicitly
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    // Settings of their own, so the editor's don't change what is measured
+    app.setOrganizationName("Mactext");
+    app.setApplicationName("Mactext Benchmarks");
+
+    Benchmarks benchmarks;
+    return QTest::qExec(&benchmarks, argc, argv);
+}
+
+#include "benchmarks.moc"
@@ -0,0 +1,8 @@
+QT += testlib widgets
+CONFIG += testcase benchmark console
+CONFIG -= app_bundle
+TARGET = benchmarks
+
+include(../src/src.pri)
+
+SOURCES       = benchmarks.cpp
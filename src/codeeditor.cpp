@@ -0,0 +1,598 @@
+#include "codeeditor.h"
+#include "highlighter.h"
+#include "minimap.h"
+#include "perf.h"
+
+#include <QColor>
+#include <QDeadlineTimer>
+#include <QPainter>
+#include <QPolygonF>
+#include <QRegularExpression>
+#include <QTextDocument>
+#include <QTextLayout>
+
+CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent) {
+    lineNumberArea = new LineNumberArea(this, this);
+
+    connect(this, &QPlainTextEdit::blockCountChanged, this, &CodeEditor::updateLineNumberAreaWidth);
+    connect(this, &QPlainTextEdit::updateRequest, this, &CodeEditor::updateLineNumberArea);
+    connect(this, &QPlainTextEdit::cursorPositionChanged, this, &CodeEditor::highlightCurrentLine);
+    connect(this, &QPlainTextEdit::cursorPositionChanged, this, &CodeEditor::revealCursor);
+
+    // Cursor moves are coalesced to one highlight update per event loop turn
+    currentLineTimer.setSingleShot(true);
+    currentLineTimer.setInterval(0);
+    connect(&currentLineTimer, &QTimer::timeout, this, &CodeEditor::updateCurrentLine);
+
+    bulkInsertTimer.setInterval(0);
+    connect(&bulkInsertTimer, &QTimer::timeout, this, &CodeEditor::insertNextChunk);
+
+    // Every edit is reported through edited, with or without the piece table
+    seenRevision = document()->revision();
+    connect(document(), &QTextDocument::contentsChange, this, &CodeEditor::trackContentsChange);
+
+    // The undo stack keeps the text each edit removed and inserted
+    connect(this, &CodeEditor::edited, this, [this](qint64, qint64 removed, const QString &inserted) {
+        if (document()->isUndoRedoEnabled())
+            undoBytes += (removed + inserted.size()) * qint64(sizeof(QChar));
+    });
+
+    gutterDigits.setFont(font());
+    foldMarkerWidth = fontMetrics().height();
+    updateLineNumberAreaWidth(0);
+    updateCurrentLine();
+}
+
+void CodeEditor::enablePieceTable() {
+    if (pieceTableEnabled)
+        return;
+
+    pieceTable = PieceTable(toPlainText());
+    pieceTableEnabled = true;
+}
+
+PieceTable::Snapshot CodeEditor::snapshot() const {
+    if (pieceTableEnabled)
+        return pieceTable.snapshot();
+    return PieceTable(toPlainText()).snapshot();
+}
+
+void CodeEditor::appendText(const QString &text) {
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::End);
+
+    mirrorPaused = true;
+    cursor.insertText(text);
+    mirrorPaused = false;
+
+    if (pieceTableEnabled)
+        pieceTable.appendOriginal(text);
+}
+
+SearchIndex *CodeEditor::searchIndex() {
+    if (!matchIndex) {
+        matchIndex = new SearchIndex(document(), this);
+        if (minimap)
+            minimap->setSearchIndex(matchIndex);
+    }
+    return matchIndex;
+}
+
+void CodeEditor::showMinimap() {
+    if (minimap)
+        return;
+
+    minimap = new Minimap(this);
+    if (matchIndex)
+        minimap->setSearchIndex(matchIndex);
+    updateLineNumberAreaWidth(0);
+    placeMinimap();
+    minimap->show();
+}
+
+void CodeEditor::placeMinimap() {
+    // Between the text and the vertical scroll bar
+    if (minimap) {
+        const QRect text = viewport()->geometry();
+        minimap->setGeometry(QRect(text.right() + 1, text.top(), Minimap::preferredWidth, text.height()));
+    }
+}
+
+int CodeEditor::replaceAll(const SearchQuery &query, const QString &replacement) {
+    // One pass over a snapshot collects every match and what replaces it
+    const QString content = snapshot().text();
+    struct Replacement {
+        qsizetype position;
+        qsizetype length;
+        QString text;
+    };
+    QList<Replacement> replacements;
+    const bool complete = query.forEachMatch(content, 0, content.size(), QDeadlineTimer(SearchQuery::timeLimitMs),
+                                             [&](qsizetype position, qsizetype length, const QRegularExpressionMatch &match) {
+        replacements.append(Replacement{position, length, query.substitute(replacement, match)});
+        return true;
+    });
+    // Half a replace all is worse than none
+    if (!complete)
+        return -1;
+    if (replacements.isEmpty())
+        return 0;
+
+    // Edit back to front so earlier positions stay valid. Blocks between the matches keep
+    // their revision, so the highlighter reuses their cached runs instead of re-lexing them.
+    QTextCursor cursor(document());
+    mirrorPaused = true;
+    cursor.beginEditBlock();
+    for (auto it = replacements.crbegin(); it != replacements.crend(); ++it) {
+        cursor.setPosition(it->position);
+        cursor.setPosition(it->position + it->length, QTextCursor::KeepAnchor);
+        cursor.insertText(it->text);
+    }
+    cursor.endEditBlock();
+    mirrorPaused = false;
+
+    for (auto it = replacements.crbegin(); it != replacements.crend(); ++it) {
+        if (pieceTableEnabled) {
+            pieceTable.remove(it->position, it->length);
+            pieceTable.insert(it->position, it->text);
+        }
+        emit edited(it->position, it->length, it->text);
+    }
+    return replacements.size();
+}
+
+void CodeEditor::trackContentsChange(int position, int charsRemoved, int /* charsAdded */) {
+    const qint64 newLength = document()->characterCount() - 1;
+    const qint64 oldLength = pieceTableEnabled ? pieceTable.length() : textLength;
+    const int revision = std::exchange(seenRevision, document()->revision());
+    textLength = newLength;
+    if (mirrorPaused)
+        return;
+    // Format-only notifications, e.g. from the highlighter, leave the revision alone. It
+    // only moves while undo is enabled, so without undo the mirror compares the text below.
+    const bool revisionUnchanged = revision == seenRevision;
+    if (revisionUnchanged && (!pieceTableEnabled || document()->isUndoRedoEnabled()))
+        return;
+
+    // contentsChange may count the implicit final paragraph separator, so derive the
+    // real span from the lengths before and after the change
+    const qint64 from = qMin<qint64>(position, oldLength);
+    const qint64 removed = qBound<qint64>(0, charsRemoved, oldLength - from);
+    const qint64 added = newLength - (oldLength - removed);
+    if (added < 0) {
+        const QString text = toPlainText();
+        if (pieceTableEnabled)
+            pieceTable = PieceTable(text);
+        emit edited(0, oldLength, text);
+        return;
+    }
+
+    QString inserted;
+    if (added > 0) {
+        QTextCursor cursor(document());
+        cursor.setPosition(from);
+        cursor.setPosition(from + added, QTextCursor::KeepAnchor);
+        inserted = cursor.selectedText();
+        inserted.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    }
+
+    if (pieceTableEnabled) {
+        if (revisionUnchanged && removed == added && pieceTable.snapshot().mid(from, removed) == inserted)
+            return;
+        pieceTable.remove(from, removed);
+        pieceTable.insert(from, inserted);
+    }
+    emit edited(from, removed, inserted);
+}
+
+int CodeEditor::lineNumberAreaWidth() {
+    return 3 + gutterDigits.width(blockCount()) + foldMarkerWidth;
+}
+
+void CodeEditor::updateLineNumberAreaWidth(int /* newBlockCount */) {
+    // A bulk insert sets the width once, after its last chunk
+    if (isBulkInserting())
+        return;
+
+    // Setting the margins relayouts the viewport, so only do it when the width changes
+    int width = lineNumberAreaWidth();
+    int right = minimap ? Minimap::preferredWidth : 0;
+    if (width == gutterWidth && right == minimapMargin)
+        return;
+    gutterWidth = width;
+    minimapMargin = right;
+    setViewportMargins(width, 0, right, 0);
+    placeMinimap();
+}
+
+void CodeEditor::updateLineNumberArea(const QRect &rect, int dy) {
+    if (dy) {
+        lineNumberArea->scroll(0, dy);
+    } else {
+        lineNumberArea->update(0, rect.y(), lineNumberArea->width(), rect.height());
+    }
+
+    if (rect.contains(viewport()->rect())) {
+        updateLineNumberAreaWidth(0);
+    }
+}
+
+void CodeEditor::resizeEvent(QResizeEvent *e) {
+    QPlainTextEdit::resizeEvent(e);
+
+    QRect cr = contentsRect();
+    lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    placeMinimap();
+}
+
+void CodeEditor::changeEvent(QEvent *e) {
+    QPlainTextEdit::changeEvent(e);
+
+    if (e->type() == QEvent::FontChange) {
+        gutterDigits.setFont(font());
+        foldMarkerWidth = fontMetrics().height();
+        updateLineNumberAreaWidth(0);
+        QRect cr = contentsRect();
+        lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    } else if (e->type() == QEvent::ReadOnlyChange) {
+        // Read-only editors show no current line
+        viewport()->update(currentLineRect());
+    }
+}
+
+void CodeEditor::highlightCurrentLine() {
+    if (!currentLineTimer.isActive())
+        currentLineTimer.start();
+}
+
+void CodeEditor::updateCurrentLine() {
+    QTextCursor cursor = textCursor();
+    QTextBlock block = cursor.block();
+    int line = -1;
+    if (QTextLayout *layout = block.layout()) {
+        QTextLine textLine = layout->lineForTextPosition(cursor.positionInBlock());
+        if (textLine.isValid())
+            line = textLine.lineNumber();
+    }
+    if (block == currentLineBlock && line == currentLine)
+        return;
+
+    // Repaint just the line left and the line entered
+    viewport()->update(currentLineRect());
+    currentLineBlock = block;
+    currentLine = line;
+    viewport()->update(currentLineRect());
+}
+
+QRect CodeEditor::currentLineRect() const {
+    if (!currentLineBlock.isValid() || !currentLineBlock.isVisible())
+        return QRect();
+
+    QRectF blockRect = blockBoundingGeometry(currentLineBlock).translated(contentOffset());
+    QTextLayout *layout = currentLineBlock.layout();
+    if (layout && currentLine >= 0 && currentLine < layout->lineCount()) {
+        QRectF lineRect = layout->lineAt(currentLine).rect();
+        return QRectF(0, blockRect.top() + lineRect.top(), viewport()->width(), lineRect.height()).toAlignedRect();
+    }
+    return QRectF(0, blockRect.top(), viewport()->width(), blockRect.height()).toAlignedRect();
+}
+
+void CodeEditor::paintEvent(QPaintEvent *e) {
+    static const QColor lineColor = QColor(Qt::yellow).lighter(160);
+
+    if (!isReadOnly()) {
+        QRect line = currentLineRect();
+        if (line.intersects(e->rect())) {
+            QPainter painter(viewport());
+            painter.fillRect(line, lineColor);
+        }
+    }
+    QPlainTextEdit::paintEvent(e);
+}
+
+void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event) {
+    PerfScope perf("CodeEditor::lineNumberAreaPaintEvent");
+
+    // Only the damaged rect is filled and only the numbers overlapping it are drawn
+    const QRect damaged = event->rect();
+    QPainter painter(lineNumberArea);
+    painter.fillRect(damaged, Qt::lightGray);
+    painter.setPen(Qt::black);
+    painter.setFont(font());
+    const int right = lineNumberArea->width() - foldMarkerWidth;
+    const int lineHeight = fontMetrics().height();
+
+    QTextBlock block = firstVisibleBlock();
+    int blockNumber = block.blockNumber();
+    int top = static_cast<int>(blockBoundingGeometry(block).translated(contentOffset()).top());
+
+    while (block.isValid() && top <= damaged.bottom()) {
+        int bottom = top + static_cast<int>(blockBoundingRect(block).height());
+        if (block.isVisible() && bottom >= damaged.top()) {
+            gutterDigits.draw(painter, blockNumber + 1, right, top);
+            if (isFoldStart(block)) {
+                // A triangle pointing right when folded, down when open
+                const QRectF box(right + lineHeight / 4.0, top + lineHeight / 4.0, lineHeight / 2.0, lineHeight / 2.0);
+                QPolygonF marker;
+                if (isFolded(block))
+                    marker << box.topLeft() << QPointF(box.right(), box.center().y()) << box.bottomLeft();
+                else
+                    marker << box.topLeft() << box.topRight() << QPointF(box.center().x(), box.bottom());
+                painter.setBrush(Qt::darkGray);
+                painter.setPen(Qt::NoPen);
+                painter.drawPolygon(marker);
+                painter.setPen(Qt::black);
+            }
+        }
+
+        block = block.next();
+        top = bottom;
+        ++blockNumber;
+    }
+}
+
+// Bulk insert
+// Pastes too big to insert in one go trickle in per event loop turn, with the
+// highlighter, gutter and painting held back until the last chunk.
+void CodeEditor::insertFromMimeData(const QMimeData *source) {
+    // Drops land here too, with the cursor already moved to the drop position
+    if (source->hasText() && !isReadOnly()) {
+        const QString text = source->text();
+        if (text.size() >= bulkInsertThreshold) {
+            bulkInsert(text);
+            return;
+        }
+    }
+    QPlainTextEdit::insertFromMimeData(source);
+}
+
+void CodeEditor::bulkInsert(const QString &text) {
+    if (isBulkInserting())
+        return;
+
+    // The document splits blocks at \r as well, so chunks are cut at \n only
+    bulkText = text;
+    bulkText.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+    bulkText.replace(QLatin1Char('\r'), QLatin1Char('\n'));
+    bulkNext = 0;
+    bulkCursor = textCursor();
+    bulkFirstBlock = document()->findBlock(bulkCursor.selectionStart()).blockNumber();
+    bulkWasReadOnly = isReadOnly();
+    setReadOnly(true);
+
+    if (SyntaxHighlighter *highlighter = document()->findChild<SyntaxHighlighter*>())
+        highlighter->setSuspended(true);
+    viewport()->setUpdatesEnabled(false);
+    lineNumberArea->setUpdatesEnabled(false);
+    bulkInsertTimer.start();
+    emit bulkInsertProgress(0);
+}
+
+void CodeEditor::insertNextChunk() {
+    PerfScope perf("CodeEditor::insertNextChunk");
+
+    // Characters inserted per event loop turn
+    const qsizetype chunkLength = 1 << 20;
+
+    qsizetype end = qMin(bulkText.size(), bulkNext + chunkLength);
+    if (end < bulkText.size()) {
+        const qsizetype newline = bulkText.lastIndexOf(QLatin1Char('\n'), end - 1);
+        if (newline >= bulkNext)
+            end = newline + 1;
+    }
+
+    // Later chunks join the first one's edit block, so undo takes out the whole paste
+    if (bulkNext == 0)
+        bulkCursor.beginEditBlock();
+    else
+        bulkCursor.joinPreviousEditBlock();
+    bulkCursor.insertText(QStringView(bulkText).sliced(bulkNext, end - bulkNext).toString());
+    bulkCursor.endEditBlock();
+    bulkNext = end;
+
+    if (bulkNext < bulkText.size()) {
+        emit bulkInsertProgress(static_cast<int>(bulkNext * 100 / bulkText.size()));
+        return;
+    }
+
+    bulkInsertTimer.stop();
+    bulkText.clear();
+    setReadOnly(bulkWasReadOnly);
+    setTextCursor(bulkCursor);
+    viewport()->setUpdatesEnabled(true);
+    lineNumberArea->setUpdatesEnabled(true);
+    updateLineNumberAreaWidth(0);
+    if (SyntaxHighlighter *highlighter = document()->findChild<SyntaxHighlighter*>()) {
+        highlighter->setSuspended(false);
+        highlighter->highlightLazily(this, bulkFirstBlock);
+    }
+    ensureCursorVisible();
+    emit bulkInsertProgress(100);
+}
+
+// Memory accounting
+MemoryUse CodeEditor::memoryUse() const {
+    PerfScope perf("CodeEditor::memoryUse");
+
+    // Rough cost of a block's fragment and layout bookkeeping in QTextDocument
+    const qint64 blockBytes = 96;
+
+    MemoryUse use;
+    const QTextDocument *doc = document();
+    use.document = qint64(doc->characterCount()) * qint64(sizeof(QChar)) + qint64(doc->blockCount()) * blockBytes;
+    if (pieceTableEnabled)
+        use.document += pieceTable.length() * qint64(sizeof(QChar));
+    for (QTextBlock block = doc->firstBlock(); block.isValid(); block = block.next()) {
+        if (const TokenBlockData *data = static_cast<const TokenBlockData *>(block.userData()))
+            use.highlighter += qint64(sizeof(TokenBlockData)) + data->runs.capacity() * qint64(sizeof(FormatRun));
+        if (const QTextLayout *layout = block.layout())
+            use.highlighter += layout->formats().size() * qint64(sizeof(QTextLayout::FormatRange));
+    }
+    if (matchIndex)
+        use.searchIndex = matchIndex->bytes();
+    // Turning undo off, as loading does, empties the stacks
+    use.undo = doc->availableUndoSteps() + doc->availableRedoSteps() > 0 ? undoBytes : 0;
+    return use;
+}
+
+void CodeEditor::trimUndo() {
+    document()->clearUndoRedoStacks();
+    undoBytes = 0;
+}
+
+void CodeEditor::dropSearchIndex() {
+    delete matchIndex;
+    matchIndex = nullptr;
+}
+
+// Code folding
+// Brace folds end at the block that closes the fold start's last unmatched brace, which
+// stays visible; indent folds run to the last block indented deeper than the start.
+static int blockIndent(const QTextBlock &block) {
+    // Tabs count as four columns; blank blocks have no indent of their own
+    const QString text = block.text();
+    int indent = 0;
+    for (QChar c : text) {
+        if (c == QLatin1Char(' '))
+            indent += 1;
+        else if (c == QLatin1Char('\t'))
+            indent += 4;
+        else
+            return indent;
+    }
+    return -1;
+}
+
+static QTextBlock nextNonBlankBlock(QTextBlock block, int *indent) {
+    for (block = block.next(); block.isValid(); block = block.next()) {
+        *indent = blockIndent(block);
+        if (*indent >= 0)
+            break;
+    }
+    return block;
+}
+
+QTextBlock CodeEditor::foldEnd(const QTextBlock &block) {
+    SyntaxHighlighter *highlighter = document()->findChild<SyntaxHighlighter*>();
+    TokenBlockData *tokens = highlighter ? highlighter->blockTokens(block) : nullptr;
+
+    if (tokens && tokens->braces.opens > 0) {
+        // Only the brace counts are walked, lexing blocks the highlighter hasn't reached yet
+        int depth = tokens->braces.opens;
+        for (QTextBlock next = block.next(); next.isValid(); next = next.next()) {
+            const BraceCounts &braces = highlighter->blockTokens(next)->braces;
+            depth -= braces.closes;
+            if (depth <= 0)
+                return next.previous() == block ? QTextBlock() : next.previous();
+            depth += braces.opens;
+        }
+        return QTextBlock();
+    }
+
+    const int indent = blockIndent(block);
+    int nextIndent = -1;
+    QTextBlock next = nextNonBlankBlock(block, &nextIndent);
+    if (indent < 0 || !next.isValid() || nextIndent <= indent)
+        return QTextBlock();
+    QTextBlock last = next;
+    while ((next = nextNonBlankBlock(last, &nextIndent)).isValid() && nextIndent > indent)
+        last = next;
+    return last;
+}
+
+bool CodeEditor::isFoldStart(const QTextBlock &block) {
+    if (isFolded(block))
+        return true;
+    // Painting asks for every visible line, so only look one block ahead and use the tokens
+    // the highlighter already has; lexing here would stall the paint on an unreached block
+    const TokenBlockData *tokens = SyntaxHighlighter::cachedTokens(block);
+    if (tokens && tokens->braces.opens > 0)
+        return block.next().isValid();
+    const int indent = blockIndent(block);
+    int nextIndent = -1;
+    return indent >= 0 && nextNonBlankBlock(block, &nextIndent).isValid() && nextIndent > indent;
+}
+
+bool CodeEditor::isFolded(const QTextBlock &block) const {
+    return block.isVisible() && block.next().isValid() && !block.next().isVisible();
+}
+
+void CodeEditor::setBlocksVisible(QTextBlock block, const QTextBlock &last, bool visible) {
+    PerfScope perf("CodeEditor::setBlocksVisible");
+    const QTextBlock first = block;
+
+    // A hidden block counts no lines, so the scroll range and paint skip it
+    for (; block.isValid(); block = block.next()) {
+        block.setVisible(visible);
+        block.setLineCount(visible ? qMax(1, block.layout()->lineCount()) : 0);
+        if (block == last)
+            break;
+    }
+    // Marking the range dirty has the layout relay it out and recount the document size,
+    // rather than the size signal being sent from outside the layout
+    document()->markContentsDirty(first.position(), last.position() + last.length() - first.position());
+    viewport()->update();
+    lineNumberArea->update();
+}
+
+void CodeEditor::toggleFold(const QTextBlock &block) {
+    if (isFolded(block)) {
+        // Folds nested inside open along with it
+        QTextBlock last = block.next();
+        while (last.next().isValid() && !last.next().isVisible())
+            last = last.next();
+        setBlocksVisible(block.next(), last, true);
+    } else if (QTextBlock last = foldEnd(block); last.isValid()) {
+        setBlocksVisible(block.next(), last, false);
+    }
+}
+
+void CodeEditor::foldAtCursor() {
+    // Folds the innermost fold the cursor is in, starting from its own line
+    const QTextBlock cursorBlock = textCursor().block();
+    for (QTextBlock block = cursorBlock; block.isValid(); block = block.previous()) {
+        if (!isFolded(block) && isFoldStart(block)) {
+            QTextBlock last = foldEnd(block);
+            if (last.isValid() && (block == cursorBlock || last.blockNumber() >= cursorBlock.blockNumber())) {
+                setTextCursor(QTextCursor(block));
+                setBlocksVisible(block.next(), last, false);
+                return;
+            }
+        }
+    }
+}
+
+void CodeEditor::unfoldAtCursor() {
+    QTextBlock block = textCursor().block();
+    if (isFolded(block))
+        toggleFold(block);
+}
+
+void CodeEditor::unfoldAll() {
+    QTextBlock block = document()->firstBlock();
+    while (block.isValid()) {
+        if (isFolded(block))
+            toggleFold(block);
+        block = block.next();
+    }
+}
+
+void CodeEditor::revealCursor() {
+    // Find, undo and go-to-line can move the cursor into a folded range
+    QTextBlock block = textCursor().block();
+    if (block.isVisible())
+        return;
+    while (block.isValid() && !block.isVisible())
+        block = block.previous();
+    if (block.isValid())
+        toggleFold(block);
+}
+
+void CodeEditor::lineNumberAreaMousePressEvent(QMouseEvent *event) {
+    // Only the marker column toggles folds
+    if (event->position().x() < lineNumberArea->width() - foldMarkerWidth)
+        return;
+    QTextBlock block = cursorForPosition(QPoint(0, static_cast<int>(event->position().y()))).block();
+    if (block.isValid() && isFoldStart(block))
+        toggleFold(block);
+}
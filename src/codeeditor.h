@@ -0,0 +1,142 @@
+#ifndef CODEEDITOR_H
+#define CODEEDITOR_H
+
+#include "gutter.h"
+#include "piecetable.h"
+#include "search.h"
+
+#include <QMimeData>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPlainTextEdit>
+#include <QResizeEvent>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTimer>
+#include <QWidget>
+
+// Memory accounting
+// Estimated bytes one editor holds, by what holds them. Qt doesn't report the sizes of its
+// text structures, so these are worked out from character, block and run counts.
+struct MemoryUse {
+    qint64 document = 0;        // Text, block bookkeeping and the piece table
+    qint64 highlighter = 0;     // Cached token runs and the formats applied from them
+    qint64 searchIndex = 0;
+    qint64 undo = 0;            // Text held by the undo and redo stacks, as the piece table saw it
+
+    qint64 total() const { return document + highlighter + searchIndex + undo; }
+};
+
+// Custom editor with line numbers and syntax highlighting
+class Minimap;
+
+class CodeEditor : public QPlainTextEdit, public LineNumberGutter {
+    Q_OBJECT
+
+public:
+    CodeEditor(QWidget *parent = nullptr);
+    using QPlainTextEdit::firstVisibleBlock;
+
+    void lineNumberAreaPaintEvent(QPaintEvent *event) override;
+    int lineNumberAreaWidth() override;
+    void lineNumberAreaMousePressEvent(QMouseEvent *event) override;
+
+    // Code folding over the brace counts the highlighter keeps per block, or indentation
+    // where a block opens no brace. Folded blocks are hidden and take up no lines, so
+    // layout, scrolling and painting pass over them.
+    bool isFoldStart(const QTextBlock &block);
+    bool isFolded(const QTextBlock &block) const;
+    void toggleFold(const QTextBlock &block);
+    void foldAtCursor();
+    void unfoldAtCursor();
+    void unfoldAll();
+
+    // Mirrors the document into a piece table, which gives cheap snapshots for saving and searching
+    void enablePieceTable();
+    // A snapshot of the plain text; built on the spot when no piece table is attached
+    PieceTable::Snapshot snapshot() const;
+    // Appends text at the end of the document; the piece table shares the string instead of copying it
+    void appendText(const QString &text);
+    // Replaces every match as one undoable edit; returns the count, or -1 if a regex scan ran out of time
+    int replaceAll(const SearchQuery &query, const QString &replacement);
+    // Match index for the find dialog, created on first use
+    SearchIndex *searchIndex();
+    // Shows an overview of the whole document to the right of the text
+    void showMinimap();
+
+    // Pastes and drops at least this many characters long go through bulkInsert
+    static const int bulkInsertThreshold = 1 << 20;
+    // Replaces the selection with text in chunks, one per event loop turn, as a single
+    // undoable edit. The editor is read-only and neither highlights nor repaints until the
+    // last chunk is in; then it lays out once and highlights the viewport first.
+    void bulkInsert(const QString &text);
+    bool isBulkInserting() const { return bulkInsertTimer.isActive(); }
+
+    // Walks every block for the highlighter's share, so it is for reports, not every frame
+    MemoryUse memoryUse() const;
+    // Drops the undo and redo history
+    void trimUndo();
+    // Drops the find dialog's match index; searchIndex() builds a new one when next asked
+    void dropSearchIndex();
+
+signals:
+    // Each change to the text, for the crash journal and undo accounting; reported whether
+    // or not the piece table mirror is on. Text added through appendText is a load rather
+    // than an edit and isn't reported.
+    void edited(qint64 position, qint64 removed, const QString &inserted);
+    // Percent of a bulkInsert done; 100 once it has finished
+    void bulkInsertProgress(int percent);
+
+protected:
+    void insertFromMimeData(const QMimeData *source) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+
+private slots:
+    void updateLineNumberAreaWidth(int newBlockCount);
+    void highlightCurrentLine();
+    void updateCurrentLine();
+    void updateLineNumberArea(const QRect &, int);
+    void trackContentsChange(int position, int charsRemoved, int charsAdded);
+    void revealCursor();
+    void insertNextChunk();
+
+private:
+    QWidget *lineNumberArea;
+    GutterDigits gutterDigits;
+    int gutterWidth = 0;    // Width the viewport margin was last set to
+    int foldMarkerWidth = 0;
+    Minimap *minimap = nullptr;
+    int minimapMargin = 0;  // Right viewport margin, likewise
+    void placeMinimap();
+
+    // Last block a fold starting at block hides, or an invalid block if it hides none
+    QTextBlock foldEnd(const QTextBlock &block);
+    void setBlocksVisible(QTextBlock first, const QTextBlock &last, bool visible);
+
+    // Current line highlight, painted under the text by paintEvent
+    QRect currentLineRect() const;
+    QTextBlock currentLineBlock;
+    int currentLine = -1;   // Layout line within currentLineBlock
+    QTimer currentLineTimer;
+    SearchIndex *matchIndex = nullptr;
+    PieceTable pieceTable;
+    bool pieceTableEnabled = false;
+    bool mirrorPaused = false;
+    // Text length and revision as of the last change seen, for when the mirror is off
+    qint64 textLength = 0;
+    int seenRevision = 0;
+
+    // Bulk insert in progress: the text, how much of it is in, and where it goes
+    QString bulkText;
+    qsizetype bulkNext = 0;
+    QTextCursor bulkCursor;
+    int bulkFirstBlock = 0;
+    bool bulkWasReadOnly = false;
+    QTimer bulkInsertTimer;
+
+    qint64 undoBytes = 0;
+};
+
+#endif // CODEEDITOR_H
@@ -0,0 +1,171 @@
+#include "editjournal.h"
+
+#include <QDataStream>
+#include <QSaveFile>
+#include <QStringConverter>
+
+EditJournal::EditJournal(const QString &path, QObject *parent) : QObject(parent), file(path) {
+    // Written a moment after typing pauses rather than on every keystroke
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(500);
+    connect(&flushTimer, &QTimer::timeout, this, &EditJournal::flush);
+}
+
+EditJournal::~EditJournal() {
+    flush();
+}
+
+QByteArray EditJournal::encode(const Header &header) {
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << magic << header.filePath << header.baseSize << header.baseModified
+           << qint32(header.format.encoding) << header.format.byteOrderMark << header.format.crlf;
+    return bytes;
+}
+
+QByteArray EditJournal::encode(const Delta &delta) {
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << delta.position << delta.removed << delta.text;
+    return bytes;
+}
+
+bool EditJournal::create(const Header &header) {
+    base = header;
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    const QByteArray bytes = encode(header);
+    return file.write(bytes) == bytes.size() && file.flush();
+}
+
+bool EditJournal::resume() {
+    QList<Delta> deltas;
+    return read(file.fileName(), base, deltas) && file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+bool EditJournal::read(const QString &path, Header &header, QList<Delta> &deltas) {
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&in);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint32 fileMagic = 0;
+    qint32 encoding = 0;
+    stream >> fileMagic >> header.filePath >> header.baseSize >> header.baseModified
+           >> encoding >> header.format.byteOrderMark >> header.format.crlf;
+    if (stream.status() != QDataStream::Ok || fileMagic != magic)
+        return false;
+    header.format.encoding = static_cast<QStringConverter::Encoding>(encoding);
+
+    while (!stream.atEnd()) {
+        Delta delta;
+        stream >> delta.position >> delta.removed >> delta.text;
+        if (stream.status() != QDataStream::Ok)
+            break;
+        deltas.append(delta);
+    }
+    return true;
+}
+
+void EditJournal::record(qint64 position, qint64 removed, const QString &text) {
+    bool merged = false;
+    if (hasPending) {
+        const qint64 pendingEnd = pending.position + pending.text.size();
+        if (removed == 0 && position == pendingEnd) {
+            // Typing on
+            pending.text += text;
+            merged = true;
+        } else if (text.isEmpty() && position + removed == pendingEnd && removed <= pending.text.size()) {
+            // Backspacing over what was just typed
+            pending.text.chop(removed);
+            merged = true;
+        } else if (text.isEmpty() && pending.text.isEmpty() && position + removed == pending.position) {
+            // Backspacing further back
+            pending.position = position;
+            pending.removed += removed;
+            merged = true;
+        } else if (text.isEmpty() && pending.text.isEmpty() && position == pending.position) {
+            // Deleting forwards
+            pending.removed += removed;
+            merged = true;
+        } else {
+            append(encode(pending));
+        }
+    }
+    if (!merged) {
+        pending = Delta{position, removed, text};
+        hasPending = true;
+    }
+
+    if (pending.text.size() > maxPendingChars) {
+        append(encode(pending));
+        hasPending = false;
+    }
+    if (buffer.size() >= writeThreshold)
+        writeBuffer();
+    flushTimer.start();
+}
+
+void EditJournal::append(const QByteArray &bytes) {
+    buffer += bytes;
+    if (compacting)
+        sinceCompaction += bytes;
+}
+
+void EditJournal::writeBuffer() {
+    if (file.isOpen() && !buffer.isEmpty()) {
+        file.write(buffer);
+        file.flush();
+    }
+    buffer.clear();
+}
+
+void EditJournal::flush() {
+    flushTimer.stop();
+    if (hasPending) {
+        append(encode(pending));
+        hasPending = false;
+    }
+    writeBuffer();
+}
+
+void EditJournal::discard() {
+    flushTimer.stop();
+    hasPending = false;
+    buffer.clear();
+    file.close();
+    file.remove();
+    // Off the tab straight away, so it is no longer found as the tab's journal
+    setParent(nullptr);
+    deleteLater();
+}
+
+void EditJournal::beginCompaction() {
+    flush();
+    compacting = true;
+    sinceCompaction.clear();
+}
+
+void EditJournal::cancelCompaction() {
+    compacting = false;
+    sinceCompaction.clear();
+}
+
+bool EditJournal::finishCompaction(const Header &header, const Delta &delta) {
+    flush();
+    compacting = false;
+
+    // The compacted journal replaces the old one whole or not at all
+    QSaveFile compacted(file.fileName());
+    bool ok = compacted.open(QIODevice::WriteOnly) && compacted.write(encode(header)) >= 0
+              && compacted.write(encode(delta)) >= 0 && compacted.write(sinceCompaction) >= 0;
+    sinceCompaction.clear();
+    file.close();
+    ok = ok && compacted.commit();
+    if (ok)
+        base = header;
+    return file.open(QIODevice::WriteOnly | QIODevice::Append) && ok;
+}
@@ -0,0 +1,79 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include "textformat.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QObject>
+#include <QTimer>
+
+// Crash recovery journal
+// Append-only log of the edits made to one tab since its base: the file as it was on disk
+// when the journal was started, or nothing for an untitled document. Typing is coalesced
+// and records are buffered, so an edit costs an append to memory however large the
+// document is; replaying the records over the base brings the text back after a crash.
+class EditJournal : public QObject {
+    Q_OBJECT
+
+public:
+    struct Header {
+        QString filePath;
+        qint64 baseSize = 0;
+        QDateTime baseModified;
+        TextFormat format;
+    };
+    struct Delta {
+        qint64 position = 0;
+        qint64 removed = 0;
+        QString text;
+    };
+
+    EditJournal(const QString &path, QObject *parent = nullptr);
+    ~EditJournal() override;
+
+    // Starts an empty journal at the path
+    bool create(const Header &header);
+    // Goes on appending to an existing journal, e.g. one recovered after a crash
+    bool resume();
+    // Reads a journal; a record cut short by a crash ends it
+    static bool read(const QString &path, Header &header, QList<Delta> &deltas);
+
+    void record(qint64 position, qint64 removed, const QString &text);
+    void flush();
+    // Deletes the journal once its edits are saved or thrown away, and the object with it
+    void discard();
+
+    QString path() const { return file.fileName(); }
+    qint64 size() const { return file.size() + buffer.size(); }
+    const Header &header() const { return base; }
+
+    // Compacting rewrites the journal as one delta against the base. Records made while
+    // the delta is worked out are kept and appended behind it.
+    void beginCompaction();
+    void cancelCompaction();
+    bool finishCompaction(const Header &header, const Delta &delta);
+    bool isCompacting() const { return compacting; }
+
+private:
+    static constexpr quint32 magic = 0x4d544a31; // "MTJ1"
+    // Buffered record bytes that trigger a write, and pending typing that triggers a record
+    static constexpr qsizetype writeThreshold = 64 * 1024;
+    static constexpr qsizetype maxPendingChars = 64 * 1024;
+
+    static QByteArray encode(const Header &header);
+    static QByteArray encode(const Delta &delta);
+    void append(const QByteArray &bytes);
+    void writeBuffer();
+
+    QFile file;
+    Header base;
+    Delta pending;
+    bool hasPending = false;
+    QByteArray buffer;
+    QTimer flushTimer;
+    bool compacting = false;
+    QByteArray sinceCompaction;
+};
+
+#endif // EDITJOURNAL_H
@@ -0,0 +1,106 @@
+#include "findreplacedialog.h"
+
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+FindReplaceDialog::FindReplaceDialog(QWidget *parent) : QDialog(parent) {
+    setWindowTitle("Find and Replace");
+    setModal(false);
+    setFixedSize(620, 230);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    // Find Section
+    QHBoxLayout *findLayout = new QHBoxLayout();
+    QLabel *findLabel = new QLabel("Find:", this);
+    findLineEdit = new QLineEdit(this);
+    findLayout->addWidget(findLabel);
+    findLayout->addWidget(findLineEdit);
+    mainLayout->addLayout(findLayout);
+
+    // Replace Section
+    QHBoxLayout *replaceLayout = new QHBoxLayout();
+    QLabel *replaceLabel = new QLabel("Replace:", this);
+    replaceLineEdit = new QLineEdit(this);
+    replaceLayout->addWidget(replaceLabel);
+    replaceLayout->addWidget(replaceLineEdit);
+    mainLayout->addLayout(replaceLayout);
+
+    // Options
+    QHBoxLayout *optionsLayout = new QHBoxLayout();
+    caseSensitiveCheckBox = new QCheckBox("Match case", this);
+    wholeWordsCheckBox = new QCheckBox("Whole words", this);
+    regexCheckBox = new QCheckBox("Regular expression", this);
+    regexCheckBox->setToolTip("Use \\1 to \\9 in the replacement for capture groups");
+    optionsLayout->addWidget(caseSensitiveCheckBox);
+    optionsLayout->addWidget(wholeWordsCheckBox);
+    optionsLayout->addWidget(regexCheckBox);
+    optionsLayout->addStretch();
+    mainLayout->addLayout(optionsLayout);
+
+    // Buttons
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    findButton = new QPushButton("Find", this);
+    findPreviousButton = new QPushButton("Previous", this);
+    replaceButton = new QPushButton("Replace", this);
+    replaceAllButton = new QPushButton("Replace All", this);
+    findAllTabsButton = new QPushButton("Find in All Tabs", this);
+    findInFolderButton = new QPushButton("Find in Folder...", this);
+    buttonLayout->addWidget(findButton);
+    buttonLayout->addWidget(findPreviousButton);
+    buttonLayout->addWidget(replaceButton);
+    buttonLayout->addWidget(replaceAllButton);
+    buttonLayout->addWidget(findAllTabsButton);
+    buttonLayout->addWidget(findInFolderButton);
+    mainLayout->addLayout(buttonLayout);
+
+    // Match Status
+    matchStatusLabel = new QLabel(this);
+    mainLayout->addWidget(matchStatusLabel);
+
+    // Connect buttons
+    connect(findButton, &QPushButton::clicked, this, &FindReplaceDialog::find);
+    connect(findPreviousButton, &QPushButton::clicked, this, &FindReplaceDialog::findPrevious);
+    connect(replaceButton, &QPushButton::clicked, this, &FindReplaceDialog::replace);
+    connect(replaceAllButton, &QPushButton::clicked, this, &FindReplaceDialog::replaceAll);
+    connect(findAllTabsButton, &QPushButton::clicked, this, &FindReplaceDialog::findInAllTabs);
+    connect(findInFolderButton, &QPushButton::clicked, this, &FindReplaceDialog::findInFolder);
+    // Find in Folder matches bytes straight from the mapped files, so it stays literal
+    connect(regexCheckBox, &QCheckBox::toggled, findInFolderButton, &QWidget::setDisabled);
+}
+
+SearchOptions FindReplaceDialog::options() const {
+    SearchOptions options;
+    options.caseSensitive = caseSensitiveCheckBox->isChecked();
+    options.wholeWords = wholeWordsCheckBox->isChecked();
+    options.regularExpression = regexCheckBox->isChecked();
+    return options;
+}
+
+void FindReplaceDialog::find() {
+    emit findText(findLineEdit->text());
+}
+
+void FindReplaceDialog::findPrevious() {
+    emit findPreviousText(findLineEdit->text());
+}
+
+void FindReplaceDialog::findInAllTabs() {
+    emit findInAllTabsText(findLineEdit->text());
+}
+
+void FindReplaceDialog::findInFolder() {
+    emit findInFolderText(findLineEdit->text());
+}
+
+void FindReplaceDialog::setMatchStatus(const QString &status) {
+    matchStatusLabel->setText(status);
+}
+
+void FindReplaceDialog::replace() {
+    emit replaceText(findLineEdit->text(), replaceLineEdit->text());
+}
+
+void FindReplaceDialog::replaceAll() {
+    emit replaceAllText(findLineEdit->text(), replaceLineEdit->text());
+}
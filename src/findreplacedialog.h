@@ -0,0 +1,57 @@
+#ifndef FINDREPLACEDIALOG_H
+#define FINDREPLACEDIALOG_H
+
+#include "search.h"
+
+#include <QCheckBox>
+#include <QDialog>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QWidget>
+
+// Find and Replace Dialog
+class FindReplaceDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    FindReplaceDialog(QWidget *parent = nullptr);
+
+    SearchOptions options() const;
+
+public slots:
+    // Shows e.g. "Match 3 of 120" under the buttons
+    void setMatchStatus(const QString &status);
+
+signals:
+    void findText(const QString &text);
+    void findPreviousText(const QString &text);
+    void replaceText(const QString &text, const QString &replacement);
+    void replaceAllText(const QString &text, const QString &replacement);
+    void findInAllTabsText(const QString &text);
+    void findInFolderText(const QString &text);
+
+private slots:
+    void find();
+    void findPrevious();
+    void findInAllTabs();
+    void findInFolder();
+    void replace();
+    void replaceAll();
+
+private:
+    QLineEdit *findLineEdit;
+    QLineEdit *replaceLineEdit;
+    QCheckBox *caseSensitiveCheckBox;
+    QCheckBox *wholeWordsCheckBox;
+    QCheckBox *regexCheckBox;
+    QPushButton *findButton;
+    QPushButton *findPreviousButton;
+    QPushButton *replaceButton;
+    QPushButton *replaceAllButton;
+    QPushButton *findAllTabsButton;
+    QPushButton *findInFolderButton;
+    QLabel *matchStatusLabel;
+};
+
+#endif // FINDREPLACEDIALOG_H
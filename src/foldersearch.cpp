@@ -0,0 +1,143 @@
+#include "foldersearch.h"
+#include "jobs.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstring>
+
+FolderSearch::FolderSearch(const QString &root, const QString &needle, const SearchOptions &options,
+                           const QStringList &ignorePatterns)
+    : root(root), bytes(needle, options.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive),
+      decoded(needle, options.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive),
+      wholeWords(options.wholeWords), fileSlots(maxFilesInFlight) {
+    for (const QString &pattern : ignorePatterns) {
+        ignored.append(QRegularExpression(QRegularExpression::wildcardToRegularExpression(pattern)));
+    }
+}
+
+void FolderSearch::cancel() {
+    cancelled.storeRelaxed(1);
+    // Wakes the walker if it is waiting for a free slot
+    fileSlots.release(maxFilesInFlight);
+}
+
+bool FolderSearch::isDone() const {
+    // The walker counts a file in flight before it stops walking, so read walking first
+    return !walking.loadAcquire() && !filesInFlight.loadAcquire();
+}
+
+bool FolderSearch::isIgnored(const QString &fileName) const {
+    for (const QRegularExpression &pattern : ignored) {
+        if (pattern.match(fileName).hasMatch())
+            return true;
+    }
+    return false;
+}
+
+// Reports each line of data holding a match once; findNext(from) returns the next match or -1
+template <typename Char, typename FindNext, typename LineText>
+static void collectLineHits(FolderSearch &search, const QString &path, const Char *data, qsizetype size,
+                            FindNext findNext, LineText lineText, QList<FolderSearchHit> &hits) {
+    qint64 line = 1;
+    qsizetype counted = 0;
+    for (qsizetype pos = findNext(0); pos != -1; pos = findNext(counted)) {
+        line += std::count(data + counted, data + pos, Char('\n'));
+        qsizetype start = pos;
+        while (start > 0 && data[start - 1] != Char('\n'))
+            --start;
+        qsizetype end = pos;
+        while (end < size && data[end] != Char('\n'))
+            ++end;
+        hits.append(FolderSearchHit{path, line, lineText(start, end - start)});
+        counted = end;
+
+        if (search.hitCount.fetchAndAddRelaxed(1) + 1 >= FolderSearch::maxHits)
+            search.cancel();
+        if (search.cancelled.loadRelaxed())
+            break;
+    }
+}
+
+static void searchFolderFile(FolderSearch &search, const QString &path) {
+    // Of a matching line, at most this many bytes are decoded for the results list
+    const qsizetype maxLineBytes = 800;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+        return;
+    const qsizetype size = file.size();
+    const char *data = reinterpret_cast<const char *>(file.map(0, size));
+    if (!data)
+        return;
+    // A NUL near the start means a binary file
+    if (memchr(data, 0, qMin<qsizetype>(size, 8192)))
+        return;
+
+    QList<FolderSearchHit> hits;
+    if (search.bytes.isValid()) {
+        collectLineHits(search, path, data, size,
+                        [&](qsizetype from) {
+                            qsizetype pos = search.bytes.indexIn(data, size, from);
+                            while (pos != -1 && search.wholeWords && !isWordAt(data, size, pos, search.bytes.size()))
+                                pos = search.bytes.indexIn(data, size, pos + 1);
+                            return pos;
+                        },
+                        [&](qsizetype start, qsizetype length) {
+                            return QString::fromUtf8(data + start, qMin(length, maxLineBytes)).trimmed().left(200);
+                        }, hits);
+    } else {
+        const QString text = QString::fromUtf8(data, size);
+        collectLineHits(search, path, text.utf16(), text.size(),
+                        [&](qsizetype from) {
+                            const qsizetype length = search.decoded.pattern().size();
+                            qsizetype pos = search.decoded.indexIn(text, from);
+                            while (pos != -1 && search.wholeWords && !isWordAt(reinterpret_cast<const char16_t *>(text.utf16()), text.size(), pos, length))
+                                pos = search.decoded.indexIn(text, pos + 1);
+                            return pos;
+                        },
+                        [&](qsizetype start, qsizetype length) {
+                            return text.mid(start, qMin(length, maxLineBytes)).trimmed().left(200);
+                        }, hits);
+    }
+
+    if (!hits.isEmpty()) {
+        QMutexLocker locker(&search.mutex);
+        search.hits.append(hits);
+    }
+}
+
+void walkFolder(const std::shared_ptr<FolderSearch> &search) {
+    // Breadth-first, so files near the root are reported first
+    QStringList pending{search->root};
+    while (!pending.isEmpty() && !search->cancelled.loadRelaxed()) {
+        QDir dir(pending.takeFirst());
+        const QFileInfoList entries = dir.entryInfoList(QDir::Dirs | QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot,
+                                                        QDir::Name);
+        for (const QFileInfo &entry : entries) {
+            if (search->cancelled.loadRelaxed())
+                break;
+            if (search->isIgnored(entry.fileName()))
+                continue;
+            if (entry.isDir()) {
+                // Symlinked directories could loop back into the tree
+                if (!entry.isSymLink())
+                    pending.append(entry.filePath());
+                continue;
+            }
+
+            search->fileSlots.acquire();
+            if (search->cancelled.loadRelaxed())
+                break;
+            search->filesInFlight.ref();
+            searchPool()->start([search, path = entry.filePath()]() {
+                if (!search->cancelled.loadRelaxed())
+                    searchFolderFile(*search, path);
+                search->filesInFlight.deref();
+                search->fileSlots.release();
+            });
+        }
+    }
+    search->walking.storeRelease(0);
+}
@@ -0,0 +1,55 @@
+#ifndef FOLDERSEARCH_H
+#define FOLDERSEARCH_H
+
+#include "search.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QSemaphore>
+
+#include <memory>
+
+// Find in Folder
+// One walker lists the tree and hands each file to searchPool(), blocking on fileSlots so
+// only a bounded number of files is mapped at once. Files are searched as UTF-8 bytes
+// straight from the mapping; workers collect hits under the mutex and the GUI thread
+// drains them on a timer. Match case and whole words come from the find dialog; regular
+// expressions aren't supported here.
+struct FolderSearchHit {
+    QString path;
+    qint64 line;    // 1-based
+    QString text;   // the matching line, trimmed
+};
+
+struct FolderSearch {
+    FolderSearch(const QString &root, const QString &needle, const SearchOptions &options,
+                 const QStringList &ignorePatterns);
+
+    void cancel();
+    bool isDone() const;
+    bool isIgnored(const QString &fileName) const;
+
+    static const int maxFilesInFlight = 64;
+    static const int maxHits = 10000;
+
+    const QString root;
+    const ByteLiteralSearcher bytes;
+    const LiteralSearcher decoded;  // For needles the byte searcher can't fold
+    const bool wholeWords;
+    QList<QRegularExpression> ignored;
+    QAtomicInt cancelled;
+    QAtomicInt walking = 1;
+    QAtomicInt filesInFlight;
+    QAtomicInt hitCount;
+    QSemaphore fileSlots;
+
+    QMutex mutex;
+    QList<FolderSearchHit> hits;    // Guarded by mutex
+};
+
+// Lists the tree under search->root and searches each file on searchPool(); returns
+// once every file has been handed out or the search was cancelled
+void walkFolder(const std::shared_ptr<FolderSearch> &search);
+
+#endif // FOLDERSEARCH_H
@@ -0,0 +1,35 @@
+#include "gutter.h"
+
+#include <QFontMetrics>
+#include <QTransform>
+
+void GutterDigits::setFont(const QFont &font) {
+    const QFontMetrics metrics(font);
+    widest = 0;
+    for (int digit = 0; digit < 10; ++digit) {
+        const QChar c(u'0' + digit);
+        glyphs[digit] = QStaticText(QString(c));
+        glyphs[digit].setTextFormat(Qt::PlainText);
+        glyphs[digit].setPerformanceHint(QStaticText::AggressiveCaching);
+        glyphs[digit].prepare(QTransform(), font);
+        advances[digit] = metrics.horizontalAdvance(c);
+        widest = qMax(widest, advances[digit]);
+    }
+}
+
+int GutterDigits::width(qint64 lineCount) const {
+    int digits = 1;
+    for (qint64 max = qMax<qint64>(1, lineCount); max >= 10; max /= 10)
+        ++digits;
+    return widest * digits;
+}
+
+void GutterDigits::draw(QPainter &painter, qint64 number, int right, int top) const {
+    int x = right;
+    do {
+        const int digit = static_cast<int>(number % 10);
+        x -= advances[digit];
+        painter.drawStaticText(x, top, glyphs[digit]);
+        number /= 10;
+    } while (number > 0);
+}
@@ -0,0 +1,57 @@
+#ifndef GUTTER_H
+#define GUTTER_H
+
+#include <QFont>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QStaticText>
+#include <QWidget>
+
+// Line number glyphs
+// The digits 0-9 are laid out once per font as QStaticText and stamped side by side,
+// so drawing a line number neither allocates a string nor shapes any text.
+class GutterDigits {
+public:
+    void setFont(const QFont &font);
+    // Width of the widest number up to lineCount
+    int width(qint64 lineCount) const;
+    // Draws number right-aligned against right, with the top of the text at top
+    void draw(QPainter &painter, qint64 number, int right, int top) const;
+
+private:
+    QStaticText glyphs[10];
+    int advances[10] = {};
+    int widest = 0;
+};
+
+// Widgets that draw a line-number gutter through LineNumberArea
+class LineNumberGutter {
+public:
+    virtual ~LineNumberGutter() = default;
+    virtual void lineNumberAreaPaintEvent(QPaintEvent *event) = 0;
+    virtual int lineNumberAreaWidth() = 0;
+    virtual void lineNumberAreaMousePressEvent(QMouseEvent * /* event */) {}
+};
+
+class LineNumberArea : public QWidget {
+public:
+    LineNumberArea(QWidget *parent, LineNumberGutter *gutter) : QWidget(parent), gutter(gutter) {}
+
+    QSize sizeHint() const override {
+        return QSize(gutter->lineNumberAreaWidth(), 0);
+    }
+
+protected:
+    void paintEvent(QPaintEvent *event) override {
+        gutter->lineNumberAreaPaintEvent(event);
+    }
+    void mousePressEvent(QMouseEvent *event) override {
+        gutter->lineNumberAreaMousePressEvent(event);
+    }
+
+private:
+    LineNumberGutter *gutter;
+};
+
+#endif // GUTTER_H
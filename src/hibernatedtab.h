@@ -0,0 +1,24 @@
+#ifndef HIBERNATEDTAB_H
+#define HIBERNATEDTAB_H
+
+#include <QWidget>
+
+// Stands in for an editor whose document was unloaded after idling in the background.
+// An unmodified file keeps only its path and is read again on wake; anything else keeps
+// its text as UTF-8, which is a fraction of what a QTextDocument holds.
+class HibernatedTab : public QWidget {
+    Q_OBJECT
+
+public:
+    HibernatedTab(QWidget *parent = nullptr) : QWidget(parent) {}
+
+    bool reloadsFromDisk() const { return !filePath.isEmpty() && !modified; }
+
+    QString filePath;
+    QByteArray text;
+    bool modified = false;
+    QVariantList viewState;     // Anchor, cursor position and scroll value
+    QVariant textFormat;
+};
+
+#endif // HIBERNATEDTAB_H
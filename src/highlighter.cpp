@@ -0,0 +1,593 @@
+#include "highlighter.h"
+#include "codeeditor.h"
+#include "perf.h"
+#include "search.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFont>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QPlainTextEdit>
+#include <QStandardPaths>
+#include <QTextCharFormat>
+#include <QThreadPool>
+
+static const QTextCharFormat &tokenFormat(TokenKind kind) {
+    static const QList<QTextCharFormat> formats = [] {
+        QList<QTextCharFormat> table(TokenKindCount);
+        table[KeywordToken].setForeground(Qt::blue);
+        table[KeywordToken].setFontWeight(QFont::Bold);
+        table[StringToken].setForeground(Qt::darkGreen);
+        table[CommentToken].setForeground(Qt::gray);
+        return table;
+    }();
+    return formats[kind];
+}
+
+// Single-pass C++ lexer.
+// Walks a block once, emitting format runs; keywords are looked up in a
+// compile-time perfect hash keyed on the first and last character.
+static constexpr const char *cppKeywords[] = {
+    "if", "else", "for", "while", "int", "double", "QString", "return",
+    "void", "class", "public", "private", "protected", "include"
+};
+
+static constexpr unsigned keywordTableSize = 32;
+
+static constexpr unsigned keywordHash(char16_t first, char16_t last) {
+    return (2u * first + last) % keywordTableSize;
+}
+
+struct KeywordTable {
+    const char *entries[keywordTableSize] = {};
+    bool collision = false;
+};
+
+static constexpr KeywordTable makeKeywordTable() {
+    KeywordTable table;
+    for (const char *keyword : cppKeywords) {
+        int length = 0;
+        while (keyword[length])
+            ++length;
+        unsigned slot = keywordHash(char16_t(keyword[0]), char16_t(keyword[length - 1]));
+        if (table.entries[slot])
+            table.collision = true;
+        table.entries[slot] = keyword;
+    }
+    return table;
+}
+
+static constexpr KeywordTable cppKeywordTable = makeKeywordTable();
+static_assert(!cppKeywordTable.collision, "cppKeywords no longer hash without collisions");
+
+static bool isCppKeyword(const char16_t *word, int length) {
+    const char *keyword = cppKeywordTable.entries[keywordHash(word[0], word[length - 1])];
+    if (!keyword)
+        return false;
+    for (int i = 0; i < length; ++i) {
+        if (keyword[i] != word[i])
+            return false;
+    }
+    return keyword[length] == '\0';
+}
+
+static int lexCppBlock(const QString &text, int startState, QList<FormatRun> &runs) {
+    const char16_t *data = reinterpret_cast<const char16_t *>(text.constData());
+    const int length = text.size();
+    int pos = 0;
+
+    if (startState == BlockCommentState) {
+        while (pos < length && !(data[pos] == '*' && pos + 1 < length && data[pos + 1] == '/'))
+            ++pos;
+        if (pos >= length) {
+            runs.append({0, length, CommentToken});
+            return BlockCommentState;
+        }
+        pos += 2;
+        runs.append({0, pos, CommentToken});
+    }
+
+    while (pos < length) {
+        const char16_t c = data[pos];
+        const int start = pos;
+
+        if (c == '/' && pos + 1 < length && data[pos + 1] == '/') {
+            runs.append({start, length - start, CommentToken});
+            return NormalState;
+        }
+
+        if (c == '/' && pos + 1 < length && data[pos + 1] == '*') {
+            pos += 2;
+            while (pos < length && !(data[pos] == '*' && pos + 1 < length && data[pos + 1] == '/'))
+                ++pos;
+            if (pos >= length) {
+                runs.append({start, length - start, CommentToken});
+                return BlockCommentState;
+            }
+            pos += 2;
+            runs.append({start, pos - start, CommentToken});
+            continue;
+        }
+
+        if (c == '"' || c == '\'') {
+            ++pos;
+            while (pos < length && data[pos] != c) {
+                if (data[pos] == '\\')
+                    ++pos;
+                ++pos;
+            }
+            pos = qMin(pos + 1, length);
+            runs.append({start, pos - start, StringToken});
+            continue;
+        }
+
+        if (isWordChar(c)) {
+            while (pos < length && isWordChar(data[pos]))
+                ++pos;
+            if (isCppKeyword(data + start, pos - start))
+                runs.append({start, pos - start, KeywordToken});
+            continue;
+        }
+
+        ++pos;
+    }
+    return NormalState;
+}
+
+// Generic lexer for languages without a hand-written one. It walks the block once like
+// lexCppBlock, driven by the definition's markers and keywords. The old per-block regex
+// rules are deliberately not kept as a further fallback, since every definition can be
+// expressed this way.
+static int lexWithRules(const Language &language, const QString &text, int startState, QList<FormatRun> &runs) {
+    const QStringView view(text);
+    const int length = text.size();
+    int pos = 0;
+    auto startsHere = [&](const QString &marker) {
+        return !marker.isEmpty() && view.sliced(pos).startsWith(marker);
+    };
+    // Ends a block comment whose body starts at from, returning false if it runs past the block
+    auto closeBlockComment = [&](int start, int from) {
+        const qsizetype end = text.indexOf(language.blockCommentEnd, from);
+        if (end == -1) {
+            runs.append({start, length - start, CommentToken});
+            return false;
+        }
+        pos = static_cast<int>(end + language.blockCommentEnd.size());
+        runs.append({start, pos - start, CommentToken});
+        return true;
+    };
+
+    if (startState == BlockCommentState && !closeBlockComment(0, 0))
+        return BlockCommentState;
+
+    while (pos < length) {
+        const char16_t c = text.at(pos).unicode();
+        const int start = pos;
+
+        if (startsHere(language.lineComment)) {
+            runs.append({start, length - start, CommentToken});
+            return NormalState;
+        }
+
+        if (startsHere(language.blockCommentStart) && !language.blockCommentEnd.isEmpty()) {
+            if (!closeBlockComment(start, pos + static_cast<int>(language.blockCommentStart.size())))
+                return BlockCommentState;
+            continue;
+        }
+
+        if (language.quotes.contains(QChar(c))) {
+            ++pos;
+            while (pos < length && text.at(pos).unicode() != c) {
+                if (text.at(pos) == QLatin1Char('\\'))
+                    ++pos;
+                ++pos;
+            }
+            pos = qMin(pos + 1, length);
+            runs.append({start, pos - start, StringToken});
+            continue;
+        }
+
+        if (isWordChar(c)) {
+            while (pos < length && isWordChar(text.at(pos).unicode()))
+                ++pos;
+            // fromRawData only wraps the characters, so the lookup costs no allocation
+            if (language.keywords.contains(QString::fromRawData(text.constData() + start, pos - start)))
+                runs.append({start, pos - start, KeywordToken});
+            continue;
+        }
+
+        ++pos;
+    }
+    return NormalState;
+}
+
+int Language::lex(const QString &text, int startState, QList<FormatRun> &runs) const {
+    return lexer ? lexer(text, startState, runs) : lexWithRules(*this, text, startState, runs);
+}
+
+const LanguageRegistry &LanguageRegistry::instance() {
+    static const LanguageRegistry registry;
+    return registry;
+}
+
+LanguageRegistry::LanguageRegistry() {
+    auto language = [](const QString &name, const QStringList &extensions, const QStringList &keywords,
+                       const QString &lineComment, const QString &blockStart, const QString &blockEnd,
+                       const QString &quotes) {
+        auto definition = std::make_unique<Language>();
+        definition->name = name;
+        definition->extensions = extensions;
+        definition->keywords = QSet<QString>(keywords.cbegin(), keywords.cend());
+        definition->lineComment = lineComment;
+        definition->blockCommentStart = blockStart;
+        definition->blockCommentEnd = blockEnd;
+        definition->quotes = quotes;
+        return definition;
+    };
+
+    auto cpp = std::make_unique<Language>();
+    cpp->name = "C++";
+    cpp->extensions = QStringList{"c", "cc", "cpp", "cxx", "h", "hh", "hpp", "hxx", "ino"};
+    cpp->lexer = lexCppBlock;
+    add(std::move(cpp));
+
+    add(language("Python", {"py", "pyw"},
+                 {"and", "as", "assert", "async", "await", "break", "class", "continue", "def", "del", "elif",
+                  "else", "except", "False", "finally", "for", "from", "global", "if", "import", "in", "is",
+                  "lambda", "None", "nonlocal", "not", "or", "pass", "raise", "return", "True", "try",
+                  "while", "with", "yield"},
+                 "#", QString(), QString(), "\"'"));
+    add(language("JavaScript", {"js", "mjs", "cjs", "ts", "jsx", "tsx"},
+                 {"async", "await", "break", "case", "catch", "class", "const", "continue", "default", "delete",
+                  "do", "else", "export", "extends", "false", "finally", "for", "function", "if", "import",
+                  "in", "instanceof", "let", "new", "null", "return", "static", "super", "switch", "this",
+                  "throw", "true", "try", "typeof", "undefined", "var", "void", "while", "yield"},
+                 "//", "/*", "*/", "\"'`"));
+    add(language("Java", {"java", "kt", "cs"},
+                 {"abstract", "boolean", "break", "case", "catch", "char", "class", "const", "continue",
+                  "default", "do", "double", "else", "enum", "extends", "false", "final", "finally", "float",
+                  "for", "if", "implements", "import", "int", "interface", "long", "new", "null", "package",
+                  "private", "protected", "public", "return", "static", "super", "switch", "this", "throw",
+                  "throws", "true", "try", "void", "while"},
+                 "//", "/*", "*/", "\"'"));
+    add(language("Shell", {"sh", "bash", "zsh"},
+                 {"case", "do", "done", "elif", "else", "esac", "export", "fi", "for", "function", "if", "in",
+                  "local", "return", "then", "until", "while"},
+                 "#", QString(), QString(), "\"'"));
+    add(language("JSON", {"json"}, {"false", "null", "true"}, QString(), QString(), QString(), "\""));
+
+    loadDefinitions(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/languages");
+}
+
+void LanguageRegistry::add(std::unique_ptr<Language> language) {
+    // Later definitions win, so a file in languages/ can replace a built-in one
+    for (const QString &extension : std::as_const(language->extensions)) {
+        byExtension.insert(extension, language.get());
+    }
+    byName.insert(language->name, language.get());
+    languages.push_back(std::move(language));
+}
+
+void LanguageRegistry::loadDefinitions(const QString &directory) {
+    const QFileInfoList files = QDir(directory).entryInfoList({"*.json"}, QDir::Files, QDir::Name);
+    for (const QFileInfo &info : files) {
+        QFile file(info.filePath());
+        QJsonParseError error;
+        const QJsonDocument json = file.open(QIODevice::ReadOnly) ? QJsonDocument::fromJson(file.readAll(), &error)
+                                                                  : QJsonDocument();
+        const QJsonObject object = json.object();
+        if (object.value("name").toString().isEmpty() || !object.value("extensions").isArray()) {
+            qWarning() << "Skipping language definition" << info.filePath();
+            continue;
+        }
+
+        auto language = std::make_unique<Language>();
+        language->name = object.value("name").toString();
+        for (const QJsonValue &extension : object.value("extensions").toArray()) {
+            language->extensions.append(extension.toString().toLower());
+        }
+        for (const QJsonValue &keyword : object.value("keywords").toArray()) {
+            language->keywords.insert(keyword.toString());
+        }
+        language->lineComment = object.value("lineComment").toString();
+        const QJsonArray blockComment = object.value("blockComment").toArray();
+        if (blockComment.size() == 2) {
+            language->blockCommentStart = blockComment.at(0).toString();
+            language->blockCommentEnd = blockComment.at(1).toString();
+        }
+        language->quotes = object.value("quotes").toString();
+        add(std::move(language));
+    }
+}
+
+const Language *LanguageRegistry::forFile(const QString &fileName) const {
+    return byExtension.value(QFileInfo(fileName).suffix().toLower());
+}
+
+static BraceCounts countBraces(const QString &text, const QList<FormatRun> &runs) {
+    BraceCounts counts;
+    qsizetype run = 0;
+    for (qsizetype pos = 0; pos < text.size(); ++pos) {
+        while (run < runs.size() && runs.at(run).start + runs.at(run).length <= pos)
+            ++run;
+        if (run < runs.size() && pos >= runs.at(run).start && runs.at(run).kind != KeywordToken) {
+            pos = runs.at(run).start + runs.at(run).length - 1;
+            continue;
+        }
+        const QChar c = text.at(pos);
+        if (c == QLatin1Char('{')) {
+            ++counts.opens;
+        } else if (c == QLatin1Char('}')) {
+            if (counts.opens > 0)
+                --counts.opens;
+            else
+                ++counts.closes;
+        }
+    }
+    return counts;
+}
+
+// Pool shared by the background tokenizers of every open tab
+static QThreadPool *tokenizerPool() {
+    static QThreadPool pool;
+    return &pool;
+}
+
+void TokenizeJob::run() {
+    int state = startState;
+    results.reserve(texts.size());
+    for (const QString &text : std::as_const(texts)) {
+        BlockTokens tokens;
+        tokens.startState = state;
+        tokens.endState = state = language->lex(text, state, tokens.runs);
+        tokens.braces = countBraces(text, tokens.runs);
+        results.append(std::move(tokens));
+    }
+    emit finished();
+}
+
+SyntaxHighlighter::SyntaxHighlighter(QTextDocument *parent, const Language *language)
+    : QSyntaxHighlighter(parent), definition(language) {
+    idleTimer.setInterval(0);
+    connect(&idleTimer, &QTimer::timeout, this, &SyntaxHighlighter::highlightNextChunk);
+}
+
+void SyntaxHighlighter::highlightLazily(CodeEditor *editor, int fromBlock) {
+    // Resuming a pass that is still running must not skip the blocks it hasn't reached
+    const int next = lazyEditor == editor ? qMin(backgroundNext, fromBlock) : fromBlock;
+    cancelLazyHighlighting();
+
+    lazyEditor = editor;
+    backgroundNext = next;
+    viewportFirst = viewportLast = -1;
+    connect(editor, &QPlainTextEdit::updateRequest, this, &SyntaxHighlighter::highlightViewport);
+
+    highlightViewport();
+    idleTimer.start();
+}
+
+void SyntaxHighlighter::cancelLazyHighlighting() {
+    idleTimer.stop();
+    if (lazyEditor) {
+        disconnect(lazyEditor, nullptr, this, nullptr);
+        lazyEditor = nullptr;
+    }
+}
+
+TokenBlockData *SyntaxHighlighter::cachedTokens(const QTextBlock &block) {
+    TokenBlockData *data = static_cast<TokenBlockData *>(block.userData());
+    return data && data->revision == block.revision() ? data : nullptr;
+}
+
+TokenBlockData *SyntaxHighlighter::blockTokens(QTextBlock block) {
+    if (!definition)
+        return nullptr;
+    if (TokenBlockData *data = cachedTokens(block))
+        return data;
+
+    // An unreached block's start state depends on the blocks above it (a "/*" opened there),
+    // so lexing resumes at the nearest block that is still current and carries on down.
+    // highlightBlock finds these cached and only has to apply the runs once it gets here.
+    QTextBlock first = block;
+    while (first.previous().isValid() && !cachedTokens(first.previous()))
+        first = first.previous();
+    const TokenBlockData *previous = cachedTokens(first.previous());
+    int state = previous ? previous->endState : int(NormalState);
+
+    for (QTextBlock next = first;; next = next.next()) {
+        TokenBlockData *data = static_cast<TokenBlockData *>(next.userData());
+        if (!data) {
+            data = new TokenBlockData;
+            next.setUserData(data);
+        }
+        const QString text = next.text();
+        data->revision = next.revision();
+        data->startState = state;
+        data->runs.clear();
+        data->endState = state = definition->lex(text, state, data->runs);
+        data->braces = countBraces(text, data->runs);
+        if (next == block)
+            return data;
+    }
+}
+
+void SyntaxHighlighter::setLoading(bool isLoading) {
+    loading = isLoading;
+    if (lazyEditor)
+        idleTimer.start();
+}
+
+void SyntaxHighlighter::setSuspended(bool isSuspended) {
+    // A lazy pass keeps its place, so resuming it doesn't skip blocks it hadn't reached
+    suspended = isSuspended;
+    if (suspended)
+        idleTimer.stop();
+}
+
+void SyntaxHighlighter::highlightViewport() {
+    if (!lazyEditor || suspended)
+        return;
+
+    QTextBlock first = lazyEditor->firstVisibleBlock();
+    int lineHeight = qMax(1, lazyEditor->fontMetrics().lineSpacing());
+    int firstNumber = first.blockNumber();
+    // Folded blocks take up no lines, so the last block on screen is found by walking
+    const int pageLines = lazyEditor->viewport()->height() / lineHeight + 1;
+    QTextBlock last = first;
+    for (int shown = 0; shown < pageLines && last.next().isValid();) {
+        last = last.next();
+        if (last.isVisible())
+            ++shown;
+    }
+    int lastNumber = last.blockNumber();
+    if (firstNumber == viewportFirst && lastNumber == viewportLast)
+        return;
+
+    viewportFirst = firstNumber;
+    viewportLast = lastNumber;
+    for (QTextBlock block = first; block.isValid() && block.blockNumber() <= lastNumber; block = block.next()) {
+        if (block.isVisible() && block.blockNumber() >= backgroundNext)
+            rehighlightBlock(block);
+    }
+}
+
+void SyntaxHighlighter::highlightNextChunk() {
+    // Keep each slice well under a frame so typing and scrolling stay responsive
+    const qint64 sliceNs = 8 * 1000 * 1000;
+    QElapsedTimer slice;
+    slice.start();
+
+    QTextBlock block = document()->findBlockByNumber(backgroundNext);
+    while (block.isValid() && slice.nsecsElapsed() < sliceNs) {
+        backgroundNext = block.blockNumber() + 1;
+        rehighlightBlock(block);
+        block = block.next();
+    }
+
+    if (!block.isValid()) {
+        if (loading)
+            idleTimer.stop();
+        else
+            cancelLazyHighlighting();
+    }
+}
+
+void SyntaxHighlighter::scheduleTokenize(const QTextBlock &block) {
+    int number = block.blockNumber();
+    if (pendingBlock == -1 || number < pendingBlock)
+        pendingBlock = number;
+
+    // Snapshot after the current edit has finished reformatting
+    if (!tokenizeQueued) {
+        tokenizeQueued = true;
+        QTimer::singleShot(0, this, &SyntaxHighlighter::startTokenize);
+    }
+}
+
+void SyntaxHighlighter::startTokenize() {
+    // Blocks handed to the worker per job; the next chunk is requested if the state still differs
+    const int chunkBlocks = 4096;
+
+    tokenizeQueued = false;
+    if (tokenizeJob || pendingBlock == -1)
+        return;
+
+    QTextBlock block = document()->findBlockByNumber(pendingBlock);
+    pendingBlock = -1;
+    if (!block.isValid())
+        return;
+
+    tokenizeJob = new TokenizeJob(definition, document()->revision(), block.blockNumber(),
+                                  qMax(int(NormalState), block.previous().userState()));
+    for (int i = 0; block.isValid() && i < chunkBlocks; ++i, block = block.next()) {
+        tokenizeJob->texts.append(block.text());
+    }
+
+    TokenizeJob *job = tokenizeJob;
+    connect(job, &TokenizeJob::finished, this, [this, job] { applyTokens(job); }, Qt::QueuedConnection);
+    // Connected second so the deferred delete is queued behind applyTokens
+    connect(job, &TokenizeJob::finished, job, &QObject::deleteLater);
+    tokenizerPool()->start(job);
+}
+
+void SyntaxHighlighter::applyTokens(const TokenizeJob *job) {
+    tokenizeJob = nullptr;
+
+    if (job->revision != document()->revision()) {
+        // Stale snapshot: throw the results away and start over from the same block
+        if (pendingBlock == -1 || job->firstBlock < pendingBlock)
+            pendingBlock = job->firstBlock;
+    } else {
+        QTextBlock first = document()->findBlockByNumber(job->firstBlock);
+        QTextBlock block = first;
+        for (const TokenizeJob::BlockTokens &tokens : job->results) {
+            if (!block.isValid())
+                break;
+            TokenBlockData *data = static_cast<TokenBlockData *>(block.userData());
+            if (!data) {
+                data = new TokenBlockData;
+                block.setUserData(data);
+            }
+            data->revision = block.revision();
+            data->startState = tokens.startState;
+            data->endState = tokens.endState;
+            data->runs = tokens.runs;
+            data->braces = tokens.braces;
+            block = block.next();
+        }
+
+        // Copies the cached runs; the state cascade carries it through the whole chunk
+        // and schedules the next one if the block after it is still out of date.
+        if (first.isValid())
+            rehighlightBlock(first);
+    }
+
+    startTokenize();
+}
+
+void SyntaxHighlighter::highlightBlock(const QString &text) {
+    PerfScope perf("SyntaxHighlighter::highlightBlock");
+
+    if (suspended)
+        return;
+    if (lazyEditor) {
+        int number = currentBlock().blockNumber();
+        if (number >= backgroundNext && (number < viewportFirst || number > viewportLast))
+            return;
+    }
+
+    if (!definition)
+        return;
+
+    const int startState = qMax(int(NormalState), previousBlockState());
+    const int revision = currentBlock().revision();
+    TokenBlockData *data = static_cast<TokenBlockData *>(currentBlockUserData());
+
+    if (data && data->revision == revision && data->startState != startState) {
+        // Only the incoming state changed (e.g. a "/*" opened above): keep the old runs
+        // and end state so the cascade stops here, and re-lex the rest in the background.
+        scheduleTokenize(currentBlock());
+    } else if (!data || data->revision != revision) {
+        // Edited or never seen: a single block is cheap enough to lex inline
+        if (!data) {
+            data = new TokenBlockData;
+            setCurrentBlockUserData(data);
+        }
+        data->revision = revision;
+        data->startState = startState;
+        data->runs.clear();
+        data->endState = definition->lex(text, startState, data->runs);
+        data->braces = countBraces(text, data->runs);
+    }
+
+    for (const FormatRun &run : std::as_const(data->runs)) {
+        setFormat(run.start, run.length, tokenFormat(run.kind));
+    }
+    setCurrentBlockState(data->endState);
+}
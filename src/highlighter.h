@@ -0,0 +1,188 @@
+#ifndef HIGHLIGHTER_H
+#define HIGHLIGHTER_H
+
+#include <QHash>
+#include <QObject>
+#include <QRunnable>
+#include <QSet>
+#include <QSyntaxHighlighter>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTimer>
+
+#include <memory>
+#include <vector>
+
+class CodeEditor;
+
+// Token classes produced by the lexers
+enum TokenKind {
+    PlainToken,
+    KeywordToken,
+    StringToken,
+    CommentToken,
+    TokenKindCount
+};
+
+// A highlighted span of a block, as produced by a lexer
+struct FormatRun {
+    int start;
+    int length;
+    TokenKind kind;
+};
+
+// Block states shared between lexers and QSyntaxHighlighter::currentBlockState()
+enum LexerState {
+    NormalState = 0,
+    BlockCommentState = 1
+};
+
+// Lexes one block starting in startState, appends its runs and returns the end state
+using LexerFunction = int (*)(const QString &text, int startState, QList<FormatRun> &runs);
+
+// Language definitions
+// A language pairs file extensions with a lexer: the hand-written C++ lexer, or a
+// generic one driven by the definition's keywords, comment markers and quote characters.
+// Built-in definitions can be overridden or extended by .json files in the languages/
+// directory of the app data location, e.g.
+//   {"name": "Go", "extensions": ["go"], "keywords": ["func", "package"],
+//    "lineComment": "//", "blockComment": ["/*", "*/"], "quotes": "\"'`"}
+struct Language {
+    QString name;
+    QStringList extensions;         // Lower case, without the dot
+    LexerFunction lexer = nullptr;  // Hand-written lexer; lexWithRules and the fields below without one
+    QSet<QString> keywords;
+    QString lineComment;
+    QString blockCommentStart;
+    QString blockCommentEnd;
+    QString quotes;                 // Each character opens and closes a string
+
+    int lex(const QString &text, int startState, QList<FormatRun> &runs) const;
+};
+
+// Language registry
+// Every definition is built or read once, on first use, and shared by all tabs.
+class LanguageRegistry {
+public:
+    static const LanguageRegistry &instance();
+
+    // The language for fileName's extension, or null for plain text and unknown extensions
+    const Language *forFile(const QString &fileName) const;
+    // What untitled documents are highlighted as
+    const Language *defaultLanguage() const { return byName.value("C++"); }
+
+private:
+    LanguageRegistry();
+    void add(std::unique_ptr<Language> language);
+    void loadDefinitions(const QString &directory);
+
+    std::vector<std::unique_ptr<Language>> languages;
+    QHash<QString, const Language *> byExtension;
+    QHash<QString, const Language *> byName;
+};
+
+// Braces outside strings and comments: closes that match nothing earlier in the block,
+// and opens left unmatched at its end. The folding index is built from these.
+struct BraceCounts {
+    int closes = 0;
+    int opens = 0;
+};
+
+// Tokenizer output cached on each block, valid while the block revision is unchanged
+class TokenBlockData : public QTextBlockUserData {
+public:
+    int revision = -1;
+    int startState = NormalState;
+    int endState = NormalState;
+    QList<FormatRun> runs;
+    BraceCounts braces;
+};
+
+// Lexes a snapshot of consecutive block texts on a worker thread
+class TokenizeJob : public QObject, public QRunnable {
+    Q_OBJECT
+
+public:
+    struct BlockTokens {
+        int startState;
+        int endState;
+        QList<FormatRun> runs;
+        BraceCounts braces;
+    };
+
+    TokenizeJob(const Language *language, int revision, int firstBlock, int startState)
+        : language(language), revision(revision), firstBlock(firstBlock), startState(startState) {
+        setAutoDelete(false);
+    }
+
+    void run() override;
+
+    const Language *const language;
+    const int revision;
+    const int firstBlock;
+    const int startState;
+    QStringList texts;
+    QList<BlockTokens> results;
+
+signals:
+    void finished();
+};
+
+// Syntax Highlighter
+// Formats blocks from the language's lexer; without a language blocks are left plain.
+class SyntaxHighlighter : public QSyntaxHighlighter {
+    Q_OBJECT
+
+public:
+    SyntaxHighlighter(QTextDocument *parent = nullptr,
+                      const Language *language = LanguageRegistry::instance().defaultLanguage());
+
+    const Language *language() const { return definition; }
+
+    // Highlight the blocks visible in editor first, then the rest in idle time slices,
+    // starting the idle pass at fromBlock (blocks above it are taken as highlighted)
+    void highlightLazily(CodeEditor *editor, int fromBlock = 0);
+    void cancelLazyHighlighting();
+    // The block's tokens, lexed on the spot without formatting it if highlighting hasn't
+    // reached it yet; null without a language
+    TokenBlockData *blockTokens(QTextBlock block);
+    // The block's tokens if they are cached and still current, without lexing anything
+    static TokenBlockData *cachedTokens(const QTextBlock &block);
+    // While the document is still loading, reaching its end only pauses the idle pass;
+    // calling this again resumes the pass over newly appended blocks.
+    void setLoading(bool loading);
+    // While suspended, changed blocks are left unformatted; resume with highlightLazily
+    void setSuspended(bool suspended);
+
+protected:
+    void highlightBlock(const QString &text) override;
+
+private slots:
+    void highlightViewport();
+    void highlightNextChunk();
+    void startTokenize();
+
+private:
+    void scheduleTokenize(const QTextBlock &block);
+    void applyTokens(const TokenizeJob *job);
+
+    const Language *definition;
+
+    // Background tokenizing: at most one job in flight, covering blocks from pendingBlock on
+    TokenizeJob *tokenizeJob = nullptr;
+    int pendingBlock = -1;
+    bool tokenizeQueued = false;
+
+    // Lazy highlighting: blocks below backgroundNext or inside the viewport are highlighted.
+    // QSyntaxHighlighter clears the formats of a block highlightBlock skips, so everything
+    // else shows as plain text until the idle pass reaches it.
+    CodeEditor *lazyEditor = nullptr;
+    QTimer idleTimer;
+    int backgroundNext = 0;
+    int viewportFirst = -1;
+    int viewportLast = -1;
+    bool loading = false;
+    bool suspended = false;
+};
+
+#endif // HIGHLIGHTER_H
@@ -0,0 +1,209 @@
+#include "jobs.h"
+#include "perf.h"
+
+#include <QDeadlineTimer>
+#include <QFile>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStringConverter>
+#include <QStringDecoder>
+#include <QStringEncoder>
+
+void FileLoadJob::run() {
+    PerfScope perf("FileLoadJob::run");
+
+    // Opened in binary mode: CRLF is folded below, after decoding, so UTF-16 survives
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        const qint64 total = file.size();
+        // Without a byte order mark the file is taken as UTF-8 and each chunk validated
+        // as it is read, so the first chunk shows without a pass over the whole file
+        bool validating = false;
+        if (formatKnown) {
+            file.seek(offset);
+        } else {
+            const QByteArray head = file.peek(3);
+            format = detectByteOrderMark(head.constData(), head.size());
+            format.ascii = validating = !format.byteOrderMark;
+        }
+
+        // Decoding from an offset must not eat a leading U+FEFF as a byte order mark
+        QStringDecoder decoder(format.encoding, offset > 0 ? QStringConverter::Flag::ConvertInitialBom
+                                                           : QStringConverter::Flag::Default);
+        bool lineEndingKnown = formatKnown;
+        bool carriageReturnHeld = false;
+        QByteArray partial;     // A UTF-8 sequence cut off by the end of the last chunk
+        while (!cancelled.loadRelaxed()) {
+            QByteArray bytes = file.read(chunkSize);
+            if (bytes.isEmpty() && partial.isEmpty())
+                break;
+
+            QString text;
+            if (validating) {
+                const bool atEnd = bytes.isEmpty();
+                bytes.prepend(std::exchange(partial, QByteArray()));
+                bool ascii;
+                qint64 complete;
+                if (isValidUtf8(bytes.constData(), bytes.size(), &ascii, atEnd ? nullptr : &complete)) {
+                    if (!atEnd) {
+                        partial = bytes.mid(complete);
+                        bytes.truncate(complete);
+                    }
+                    format.ascii = format.ascii && ascii;
+                    // Latin-1 decoding is a plain widening, which is all ASCII needs
+                    text = ascii ? QString::fromLatin1(bytes) : decoder(bytes);
+                } else {
+                    // Not UTF-8 after all. ASCII chunks already sent read the same in
+                    // Latin-1; anything else has to be sent again from the start.
+                    validating = false;
+                    const bool resend = !format.ascii;
+                    format.encoding = QStringConverter::Latin1;
+                    format.ascii = false;
+                    decoder = QStringDecoder(QStringConverter::Latin1);
+                    if (resend) {
+                        file.seek(0);
+                        lineEndingKnown = false;
+                        carriageReturnHeld = false;
+                        emit restarted();
+                        continue;
+                    }
+                    text = QString::fromLatin1(bytes);
+                }
+            } else {
+                if (bytes.isEmpty())
+                    break;
+                // Latin-1 decoding is a plain widening, which is all ASCII needs
+                text = format.ascii ? QString::fromLatin1(bytes) : decoder(bytes);
+            }
+
+            // A CR at the end of a chunk may be half of a CRLF
+            if (carriageReturnHeld)
+                text.prepend(QLatin1Char('\r'));
+            carriageReturnHeld = text.endsWith(QLatin1Char('\r'));
+            if (carriageReturnHeld)
+                text.chop(1);
+            if (!lineEndingKnown) {
+                qsizetype newline = text.indexOf(QLatin1Char('\n'));
+                if (newline != -1) {
+                    format.crlf = newline > 0 && text.at(newline - 1) == QLatin1Char('\r');
+                    lineEndingKnown = true;
+                }
+            }
+            text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+
+            chunkSlots.acquire();
+            if (cancelled.loadRelaxed())
+                break;
+            emit chunkReady(text, file.pos(), total);
+        }
+        if (carriageReturnHeld && !cancelled.loadRelaxed()) {
+            chunkSlots.acquire();
+            if (!cancelled.loadRelaxed())
+                emit chunkReady(QString(QLatin1Char('\r')), total, total);
+        }
+        bytesLoaded = file.pos();
+    }
+    emit finished();
+}
+
+void SaveJob::run() {
+    PerfScope perf("SaveJob::run");
+
+    // Characters encoded per write
+    const qsizetype sliceSize = 1 << 20;
+
+    // Text that Latin-1 can't hold is written as UTF-8 rather than with question marks
+    if (format.encoding == QStringConverter::Latin1) {
+        bool representable = true;
+        snapshot.forEachPiece([&](QStringView piece) {
+            for (QChar c : piece) {
+                if (c.unicode() > 0xff) {
+                    representable = false;
+                    break;
+                }
+            }
+        });
+        if (!representable)
+            format.encoding = QStringConverter::Utf8;
+    }
+
+    // Line endings are written explicitly, so Text mode stays off on every platform
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly)) {
+        QStringEncoder encoder(format.encoding, format.byteOrderMark ? QStringConverter::Flag::WriteBom
+                                                                     : QStringConverter::Flag::Default);
+        bool written = true;
+        snapshot.forEachPiece([&](QStringView piece) {
+            for (qsizetype pos = 0; written && pos < piece.size(); pos += sliceSize) {
+                QByteArray bytes;
+                if (format.crlf) {
+                    QString slice = piece.mid(pos, sliceSize).toString();
+                    slice.replace(QLatin1Char('\n'), QLatin1String("\r\n"));
+                    bytes = encoder(slice);
+                } else {
+                    bytes = encoder(piece.mid(pos, sliceSize));
+                }
+                written = file.write(bytes) == bytes.size();
+            }
+        });
+        ok = written && file.commit();
+    }
+    if (!ok)
+        errorString = file.errorString();
+    emit finished();
+    done.release();
+}
+
+QThreadPool *savePool() {
+    static QThreadPool pool;
+    return &pool;
+}
+
+void ReloadJob::run() {
+    PerfScope perf("ReloadJob::run");
+
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        const QByteArray bytes = file.readAll();
+        bytesLoaded = bytes.size();
+        format = detectTextFormat(bytes.constData(), bytes.size());
+        QStringDecoder decoder(format.encoding);
+        QString text = format.ascii ? QString::fromLatin1(bytes) : decoder(bytes);
+        qsizetype newline = text.indexOf(QLatin1Char('\n'));
+        format.crlf = newline > 0 && text.at(newline - 1) == QLatin1Char('\r');
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+
+        const QString current = snapshot.text();
+        const qsizetype common = qMin(current.size(), text.size());
+        while (prefix < common && current.at(prefix) == text.at(prefix))
+            ++prefix;
+        qsizetype suffix = 0;
+        while (suffix < common - prefix
+               && current.at(current.size() - 1 - suffix) == text.at(text.size() - 1 - suffix)) {
+            ++suffix;
+        }
+        removedLength = current.size() - prefix - suffix;
+        replacement = text.mid(prefix, text.size() - prefix - suffix);
+        ok = true;
+    }
+    emit finished();
+}
+
+void ChunkSearchJob::run() {
+    if (!cancelled->loadRelaxed()) {
+        // Off the GUI thread there is no deadline; cancelling stops a slow pattern
+        const QString text = snapshot.mid(start, length + query.lookahead());
+        query.forEachMatch(text, 0, length, QDeadlineTimer::Forever,
+                           [this](qsizetype pos, qsizetype matchLength, const QRegularExpressionMatch &) {
+            matches.append(start + pos);
+            matchLengths.append(static_cast<int>(matchLength));
+            return !cancelled->loadRelaxed();
+        });
+    }
+    emit finished();
+}
+
+QThreadPool *searchPool() {
+    static QThreadPool pool;
+    return &pool;
+}
@@ -0,0 +1,162 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "piecetable.h"
+#include "search.h"
+#include "textformat.h"
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QWidget>
+
+#include <memory>
+
+// Reads and decodes a file on a worker thread, handing it to the GUI thread in fixed-size chunks.
+// At most a few chunks are in flight, so a slow consumer bounds the memory used.
+class FileLoadJob : public QObject, public QRunnable {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 chunkSize = 1 << 20;
+    static constexpr int maxChunksInFlight = 4;
+
+    FileLoadJob(const QString &fileName) : fileName(fileName), chunkSlots(maxChunksInFlight) {
+        setAutoDelete(false);
+    }
+    // Reads only the bytes from offset on, decoded with the format the tab already has.
+    // From offset 0 a byte order mark is still skipped.
+    FileLoadJob(const QString &fileName, qint64 offset, const TextFormat &knownFormat)
+        : fileName(fileName), offset(offset), formatKnown(true), chunkSlots(maxChunksInFlight) {
+        format = knownFormat;
+        // Appended bytes needn't be ASCII just because the start of the file was
+        format.ascii = false;
+        setAutoDelete(false);
+    }
+
+    void run() override;
+
+    // Valid once finished has been emitted
+    TextFormat format;
+    qint64 bytesLoaded = 0;
+
+    // GUI thread
+    void chunkConsumed() { chunkSlots.release(); }
+    void cancel() {
+        cancelled.storeRelaxed(1);
+        chunkSlots.release(maxChunksInFlight);
+    }
+
+signals:
+    void chunkReady(const QString &text, qint64 bytesRead, qint64 totalBytes);
+    // The file turned out not to be UTF-8; the text sent so far is void and comes again
+    void restarted();
+    void finished();
+
+private:
+    const QString fileName;
+    const qint64 offset = 0;
+    const bool formatKnown = false;
+    QSemaphore chunkSlots;
+    QAtomicInt cancelled;
+};
+
+// Encodes a text snapshot and writes it on a worker thread.
+// QSaveFile writes to a temporary file and only fsyncs and renames it over the target on
+// commit, so a crash part-way through never leaves a truncated file behind.
+class SaveJob : public QObject, public QRunnable {
+    Q_OBJECT
+
+public:
+    SaveJob(const PieceTable::Snapshot &snapshot, const QString &fileName, const TextFormat &format = {})
+        : snapshot(snapshot), fileName(fileName), format(format) {
+        setAutoDelete(false);
+    }
+
+    void run() override;
+
+    // Blocks until run() has returned on whichever thread picked the job up
+    void wait() {
+        done.acquire();
+        done.release();
+    }
+
+    const PieceTable::Snapshot snapshot;
+    const QString fileName;
+    TextFormat format;      // What was actually written
+    bool ok = false;
+    QString errorString;
+
+signals:
+    void finished();
+
+private:
+    QSemaphore done;
+};
+
+// Saves get their own pool so waiting for them never waits on loaders blocked on the GUI thread
+QThreadPool *savePool();
+
+// Rereads a file that was rewritten on disk and diffs it against the tab's text on a
+// worker thread. Only the span between the common prefix and suffix is handed back, so
+// the GUI thread replaces just that and the unchanged blocks keep their highlighting.
+class ReloadJob : public QObject, public QRunnable {
+    Q_OBJECT
+
+public:
+    ReloadJob(const QString &fileName, const PieceTable::Snapshot &snapshot, int revision)
+        : fileName(fileName), snapshot(snapshot), revision(revision) {
+        setAutoDelete(false);
+    }
+
+    void run() override;
+
+    const QString fileName;
+    const PieceTable::Snapshot snapshot;
+    const int revision;     // Document revision the snapshot was taken at
+    bool ok = false;
+    TextFormat format;
+    qint64 bytesLoaded = 0;
+    qsizetype prefix = 0;
+    qsizetype removedLength = 0;
+    QString replacement;
+
+signals:
+    void finished();
+};
+
+// Searches one chunk of a document snapshot on a worker thread.
+// The chunk is read a little past its end so matches straddling the boundary are found,
+// but only matches starting inside it are reported.
+class ChunkSearchJob : public QObject, public QRunnable {
+    Q_OBJECT
+
+public:
+    ChunkSearchJob(const PieceTable::Snapshot &snapshot, qint64 start, qint64 length,
+                   const SearchQuery &query, std::shared_ptr<QAtomicInt> cancelled)
+        : snapshot(snapshot), start(start), length(length), query(query), cancelled(std::move(cancelled)) {
+        setAutoDelete(false);
+    }
+
+    void run() override;
+
+    const PieceTable::Snapshot snapshot;
+    const qint64 start;
+    const qint64 length;
+    const SearchQuery query;
+    const std::shared_ptr<QAtomicInt> cancelled;
+    QWidget *tab = nullptr;
+    int revision = 0;
+    QList<qint64> matches;
+    QList<int> matchLengths;
+
+signals:
+    void finished();
+};
+
+// Pool for searches, so a long search never delays loads or saves
+QThreadPool *searchPool();
+
+#endif // JOBS_H
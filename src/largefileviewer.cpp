@@ -0,0 +1,317 @@
+#include "largefileviewer.h"
+
+#include <QByteArrayView>
+#include <QElapsedTimer>
+#include <QFontMetrics>
+#include <QPainter>
+#include <QStringDecoder>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <limits>
+
+LargeFileViewer::LargeFileViewer(QWidget *parent) : QAbstractScrollArea(parent) {
+    lineNumberArea = new LineNumberArea(this, this);
+    gutterDigits.setFont(font());
+    indexTimer.setInterval(0);
+    connect(&indexTimer, &QTimer::timeout, this, &LargeFileViewer::indexNextChunk);
+}
+
+bool LargeFileViewer::openFile(const QString &fileName) {
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    size = file.size();
+    data = reinterpret_cast<const char *>(file.map(0, size));
+    if (!data && size > 0)
+        return false;
+
+    detectFormat();
+    lineStarts = {textStart};
+    indexedUpTo = textStart;
+    indexTimer.start();
+    updateScrollRange();
+    return true;
+}
+
+bool LargeFileViewer::reload(bool appended) {
+    followTail = verticalScrollBar()->value() >= verticalScrollBar()->maximum();
+    // Reopened by name, since an atomic save leaves the old handle on the replaced file
+    file.close();
+    data = nullptr;
+    size = 0;
+    bool ok = file.open(QIODevice::ReadOnly);
+    if (ok) {
+        size = file.size();
+        data = reinterpret_cast<const char *>(file.map(0, size));
+        ok = data || size == 0;
+        if (!data)
+            size = 0;
+    }
+
+    if (!appended || indexedUpTo > size) {
+        detectFormat();
+        lineStarts = {textStart};
+        indexedUpTo = textStart;
+        matchOffset = -1;
+    }
+    indexTimer.start();
+    updateScrollRange();
+    viewport()->update();
+    return ok;
+}
+
+void LargeFileViewer::detectFormat() {
+    // Only the start is checked: the viewer never writes the file back, so a late byte
+    // that isn't UTF-8 costs a replacement character on screen rather than data
+    const qint64 sampleSize = 64 * 1024;
+
+    const qint64 sample = qMin(size, sampleSize);
+    format = detectByteOrderMark(data, sample);
+    if (!format.byteOrderMark) {
+        qint64 validLength;
+        if (!isValidUtf8(data, sample, &format.ascii, sample < size ? &validLength : nullptr))
+            format.encoding = QStringConverter::Latin1;
+    }
+    textStart = !format.byteOrderMark ? 0 : format.encoding == QStringConverter::Utf8 ? 3 : 2;
+    unitSize = format.encoding == QStringConverter::Utf16LE || format.encoding == QStringConverter::Utf16BE ? 2 : 1;
+}
+
+QString LargeFileViewer::decode(qint64 offset, qint64 length) const {
+    if (format.encoding == QStringConverter::Utf8)
+        return QString::fromUtf8(data + offset, length);
+    QStringDecoder decoder(format.encoding, QStringConverter::Flag::Stateless);
+    return decoder(QByteArrayView(data + offset, length - length % unitSize));
+}
+
+bool LargeFileViewer::isWholeWordAt(qint64 offset, qint64 length) const {
+    if (unitSize == 1)
+        return isWordAt(data, size, offset, length);
+
+    auto unitAt = [this](qint64 at) {
+        const uchar *p = reinterpret_cast<const uchar *>(data + at);
+        return char16_t(format.encoding == QStringConverter::Utf16LE ? p[0] | p[1] << 8 : p[0] << 8 | p[1]);
+    };
+    return (offset - 2 < textStart || !isWordChar(unitAt(offset - 2)))
+           && (offset + length + 2 > size || !isWordChar(unitAt(offset + length)));
+}
+
+bool LargeFileViewer::indexUpTo(qint64 offset, qint64 timeBudgetNs) {
+    // Scan in 1 MiB steps so the time budget is checked often enough
+    const qint64 step = 1 << 20;
+    QElapsedTimer timer;
+    timer.start();
+
+    while (indexedUpTo < size && indexedUpTo <= offset && timer.nsecsElapsed() < timeBudgetNs) {
+        const char *p = data + indexedUpTo;
+        const char *end = data + qMin(size, indexedUpTo + step);
+        while ((p = static_cast<const char *>(memchr(p, '\n', end - p)))) {
+            ++p;
+            if (unitSize == 1) {
+                lineStarts.append(p - data);
+                continue;
+            }
+            // In UTF-16 only a '\n' byte in the low half of an aligned unit with a zero
+            // high half ends a line
+            const qint64 unit = (p - 1 - data) - (format.encoding == QStringConverter::Utf16BE ? 1 : 0);
+            if ((unit - textStart) % 2 || unit + 2 > size)
+                continue;
+            if (data[format.encoding == QStringConverter::Utf16BE ? unit : unit + 1] == 0)
+                lineStarts.append(unit + 2);
+        }
+        indexedUpTo = end - data;
+    }
+    return indexedUpTo >= size;
+}
+
+void LargeFileViewer::indexNextChunk() {
+    int oldWidth = lineNumberAreaWidth();
+    if (indexUpTo(size, 8 * 1000 * 1000))
+        indexTimer.stop();
+
+    if (lineNumberAreaWidth() != oldWidth) {
+        setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+        QRect cr = contentsRect();
+        lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    }
+    updateScrollRange();
+    if (followTail)
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    if (!indexTimer.isActive())
+        followTail = false;
+}
+
+qint64 LargeFileViewer::lineEnd(qint64 line) const {
+    if (line + 1 < lineCount())
+        return lineStarts.at(line + 1) - unitSize;
+    return indexedUpTo;
+}
+
+qint64 LargeFileViewer::lineAt(qint64 offset) const {
+    auto it = std::upper_bound(lineStarts.cbegin(), lineStarts.cend(), offset);
+    return qMax<qint64>(0, (it - lineStarts.cbegin()) - 1);
+}
+
+QString LargeFileViewer::lineText(qint64 line) const {
+    // Lines longer than this are cut off rather than decoded in full
+    const qint64 maxLineBytes = 16 * 1024;
+
+    qint64 start = lineStarts.at(line);
+    qint64 end = lineEnd(line);
+    QString text = decode(start, qMin(end - start, maxLineBytes));
+    if (end - start <= maxLineBytes && text.endsWith(QLatin1Char('\r')))
+        text.chop(1);
+    text.replace(QLatin1Char('\t'), QLatin1String("    "));
+    return text;
+}
+
+void LargeFileViewer::updateScrollRange() {
+    int lineHeight = qMax(1, fontMetrics().lineSpacing());
+    int pageLines = qMax(1, viewport()->height() / lineHeight);
+    verticalScrollBar()->setPageStep(pageLines);
+    verticalScrollBar()->setRange(0, static_cast<int>(qMin<qint64>(INT_MAX, qMax<qint64>(0, lineCount() - pageLines))));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setRange(0, qMax(0, longestLineWidth - viewport()->width()));
+}
+
+bool LargeFileViewer::find(const QString &text, const SearchOptions &options, bool backward) {
+    const ByteLiteralSearcher searcher(text, options.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive,
+                                       format.encoding);
+    const qsizetype length = searcher.size();
+    auto accepted = [&](qsizetype pos) {
+        // UTF-16 matches have to start on a code unit
+        return (pos - textStart) % unitSize == 0 && (!options.wholeWords || isWholeWordAt(pos, length));
+    };
+
+    qsizetype found = -1;
+    if (!backward) {
+        qint64 from = matchOffset >= 0 ? matchOffset + matchLength : lineStarts.at(verticalScrollBar()->value());
+        found = searcher.indexIn(data, size, from);
+        while (found != -1 && !accepted(found))
+            found = searcher.indexIn(data, size, found + 1);
+    } else {
+        // There is no reverse kernel, so growing windows before the start are scanned forward
+        // and the last match starting in each is kept
+        qint64 end = matchOffset >= 0 ? matchOffset : lineStarts.at(verticalScrollBar()->value());
+        for (qint64 window = 1 << 20; found == -1 && end > 0 && searcher.isValid(); window *= 2) {
+            const qint64 start = qMax<qint64>(0, end - window);
+            const qint64 limit = qMin<qint64>(size, end - 1 + length);
+            for (qsizetype pos = searcher.indexIn(data, limit, start); pos != -1 && pos < end;
+                 pos = searcher.indexIn(data, limit, pos + 1)) {
+                if (accepted(pos))
+                    found = pos;
+            }
+            end = start;
+        }
+    }
+    if (found < 0)
+        return false;
+
+    matchOffset = found;
+    matchLength = static_cast<int>(length);
+    indexUpTo(found, std::numeric_limits<qint64>::max());
+    updateScrollRange();
+
+    qint64 line = lineAt(found);
+    int pageLines = verticalScrollBar()->pageStep();
+    verticalScrollBar()->setValue(static_cast<int>(qMax<qint64>(0, line - pageLines / 2)));
+    viewport()->update();
+    return true;
+}
+
+void LargeFileViewer::goToLine(qint64 line) {
+    while (lineCount() <= line && indexedUpTo < size) {
+        indexUpTo(indexedUpTo, std::numeric_limits<qint64>::max());
+    }
+    updateScrollRange();
+
+    line = qBound<qint64>(0, line, lineCount() - 1);
+    int pageLines = verticalScrollBar()->pageStep();
+    verticalScrollBar()->setValue(static_cast<int>(qMax<qint64>(0, line - pageLines / 2)));
+    viewport()->update();
+}
+
+void LargeFileViewer::paintEvent(QPaintEvent *event) {
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), palette().base());
+
+    const QFontMetrics metrics = fontMetrics();
+    const int lineHeight = metrics.lineSpacing();
+    const int x = 3 - horizontalScrollBar()->value();
+    const qint64 first = verticalScrollBar()->value();
+    const qint64 last = qMin(lineCount() - 1, first + viewport()->height() / lineHeight + 1);
+
+    int widest = longestLineWidth;
+    painter.setPen(palette().text().color());
+    for (qint64 line = first; line <= last; ++line) {
+        int y = static_cast<int>(line - first) * lineHeight;
+        QString text = lineText(line);
+
+        qint64 start = lineStarts.at(line);
+        if (matchOffset >= start && matchOffset <= lineEnd(line)) {
+            QString prefix = decode(start, matchOffset - start);
+            QString match = decode(matchOffset, matchLength);
+            QRect matchRect(x + metrics.horizontalAdvance(prefix), y, metrics.horizontalAdvance(match), lineHeight);
+            painter.fillRect(matchRect, palette().highlight());
+        }
+
+        painter.drawText(x, y + metrics.ascent(), text);
+        widest = qMax(widest, metrics.horizontalAdvance(text) + 6);
+    }
+
+    if (widest != longestLineWidth) {
+        longestLineWidth = widest;
+        updateScrollRange();
+    }
+}
+
+void LargeFileViewer::resizeEvent(QResizeEvent *event) {
+    QAbstractScrollArea::resizeEvent(event);
+
+    setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+    QRect cr = contentsRect();
+    lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    updateScrollRange();
+}
+
+void LargeFileViewer::changeEvent(QEvent *event) {
+    QAbstractScrollArea::changeEvent(event);
+
+    if (event->type() == QEvent::FontChange) {
+        gutterDigits.setFont(font());
+        setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+        QRect cr = contentsRect();
+        lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+        updateScrollRange();
+    }
+}
+
+void LargeFileViewer::scrollContentsBy(int /* dx */, int dy) {
+    viewport()->update();
+    // dy is in lines; scrolling the gutter leaves only the uncovered strip to repaint
+    lineNumberArea->scroll(0, dy * fontMetrics().lineSpacing());
+}
+
+int LargeFileViewer::lineNumberAreaWidth() {
+    return 3 + gutterDigits.width(lineCount());
+}
+
+void LargeFileViewer::lineNumberAreaPaintEvent(QPaintEvent *event) {
+    const QRect damaged = event->rect();
+    QPainter painter(lineNumberArea);
+    painter.fillRect(damaged, Qt::lightGray);
+    painter.setPen(Qt::black);
+    painter.setFont(font());
+
+    // Lines are a fixed height here, so the damaged range maps straight to line numbers
+    const int lineHeight = qMax(1, fontMetrics().lineSpacing());
+    const int right = lineNumberArea->width();
+    const qint64 scrolled = verticalScrollBar()->value();
+    const qint64 first = scrolled + qMax(0, damaged.top()) / lineHeight;
+    const qint64 last = qMin(lineCount() - 1, scrolled + damaged.bottom() / lineHeight);
+    for (qint64 line = first; line <= last; ++line) {
+        gutterDigits.draw(painter, line + 1, right, static_cast<int>(line - scrolled) * lineHeight);
+    }
+}
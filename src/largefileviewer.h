@@ -0,0 +1,81 @@
+#ifndef LARGEFILEVIEWER_H
+#define LARGEFILEVIEWER_H
+
+#include "gutter.h"
+#include "search.h"
+#include "textformat.h"
+
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QStringConverter>
+#include <QTimer>
+#include <QWidget>
+
+// Read-only viewer for files above the large-file threshold.
+// The file is memory-mapped and only a line-offset index is kept; just the visible lines
+// are decoded when painting. The index is built in idle time slices, so the first
+// screen paints immediately and the scroll range grows as indexing proceeds.
+class LargeFileViewer : public QAbstractScrollArea, public LineNumberGutter {
+    Q_OBJECT
+
+public:
+    LargeFileViewer(QWidget *parent = nullptr);
+
+    bool openFile(const QString &fileName);
+    // Remaps the file after it changed on disk. When it only grew the line index is kept
+    // and extended; otherwise it is rebuilt. A view scrolled to the end keeps following it.
+    bool reload(bool appended);
+    qint64 fileSize() const { return size; }
+    // Detected from a byte order mark, else from the first bytes: UTF-8 if they validate,
+    // Latin-1 otherwise
+    QStringConverter::Encoding encoding() const { return format.encoding; }
+    // Finds the next occurrence after the current match or the top of the viewport, or the
+    // previous one before it. Case is only ignored for ASCII needles; see ByteLiteralSearcher.
+    bool find(const QString &text, const SearchOptions &options, bool backward = false);
+    // Scrolls so the 0-based line is centred, indexing up to it first
+    void goToLine(qint64 line);
+
+    void lineNumberAreaPaintEvent(QPaintEvent *event) override;
+    int lineNumberAreaWidth() override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private slots:
+    void indexNextChunk();
+
+private:
+    qint64 lineCount() const { return lineStarts.size(); }
+    qint64 lineEnd(qint64 line) const;
+    qint64 lineAt(qint64 offset) const;
+    QString lineText(qint64 line) const;
+    QString decode(qint64 offset, qint64 length) const;
+    bool isWholeWordAt(qint64 offset, qint64 length) const;
+    void detectFormat();
+    bool indexUpTo(qint64 offset, qint64 timeBudgetNs);
+    void updateScrollRange();
+
+    QFile file;
+    const char *data = nullptr;
+    qint64 size = 0;
+    TextFormat format;
+    qint64 textStart = 0;   // Past the byte order mark
+    int unitSize = 1;       // Bytes per code unit: 2 for UTF-16
+    QList<qint64> lineStarts;
+    qint64 indexedUpTo = 0;
+    QTimer indexTimer;
+    bool followTail = false;
+    QWidget *lineNumberArea;
+    GutterDigits gutterDigits;
+    int longestLineWidth = 0;
+
+    qint64 matchOffset = -1;
+    int matchLength = 0;
+};
+
+#endif // LARGEFILEVIEWER_H
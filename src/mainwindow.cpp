@@ -0,0 +1,1836 @@
+#include "mainwindow.h"
+#include "editjournal.h"
+#include "findreplacedialog.h"
+#include "foldersearch.h"
+#include "hibernatedtab.h"
+#include "highlighter.h"
+#include "jobs.h"
+#include "largefileviewer.h"
+#include "perf.h"
+#include "performancepanel.h"
+#include "piecetable.h"
+#include "textformat.h"
+
+#include <QAction>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFileOpenEvent>
+#include <QFont>
+#include <QKeySequence>
+#include <QLocale>
+#include <QMenu>
+#include <QMessageBox>
+#include <QMutex>
+#include <QObject>
+#include <QRegularExpression>
+#include <QScrollBar>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QStringConverter>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThreadPool>
+
+#include <algorithm>
+
+MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
+    setWindowTitle("Advanced Qt Text Editor");
+    resize(800, 600);
+
+    // Initialize Tab Widget
+    tabWidget = new QTabWidget(this);
+    tabWidget->setTabsClosable(true);
+    setCentralWidget(tabWidget);
+
+    // Handle tab close requests
+    connect(tabWidget, &QTabWidget::tabCloseRequested, this, &MainWindow::closeTab);
+
+    // Background tabs are checked for hibernation once a minute
+    uptime.start();
+    connect(tabWidget, &QTabWidget::currentChanged, this, &MainWindow::tabChanged);
+    hibernateTimer.setInterval(60 * 1000);
+    connect(&hibernateTimer, &QTimer::timeout, this, &MainWindow::hibernateIdleTabs);
+    hibernateTimer.start();
+
+    // Create actions
+    QAction *newAction = new QAction("New", this);
+    QAction *openAction = new QAction("Open", this);
+    QAction *saveAction = new QAction("Save", this);
+    QAction *saveAsAction = new QAction("Save As", this);
+    QAction *findReplaceAction = new QAction("Find and Replace", this);
+
+    // Set shortcuts
+    newAction->setShortcut(QKeySequence::New);
+    openAction->setShortcut(QKeySequence::Open);
+    saveAction->setShortcut(QKeySequence::Save);
+    saveAsAction->setShortcut(QKeySequence::SaveAs);
+    findReplaceAction->setShortcut(QKeySequence::Find);
+
+    // Connect actions
+    connect(newAction, &QAction::triggered, this, &MainWindow::newDocument);
+    connect(openAction, &QAction::triggered, this, &MainWindow::openFile);
+    connect(saveAction, &QAction::triggered, this, &MainWindow::saveFile);
+    connect(saveAsAction, &QAction::triggered, this, &MainWindow::saveFileAs);
+    connect(findReplaceAction, &QAction::triggered, this, &MainWindow::showFindReplaceDialog);
+
+    // Create menu
+    QMenu *fileMenu = menuBar()->addMenu("File");
+    fileMenu->addAction(newAction);
+    fileMenu->addAction(openAction);
+    fileMenu->addAction(saveAction);
+    fileMenu->addAction(saveAsAction);
+
+    QMenu *editMenu = menuBar()->addMenu("Edit");
+    editMenu->addAction(findReplaceAction);
+
+    QAction *performanceAction = new QAction("Performance", this);
+    connect(performanceAction, &QAction::triggered, this, &MainWindow::showPerformancePanel);
+    QMenu *viewMenu = menuBar()->addMenu("View");
+    viewMenu->addAction(performanceAction);
+
+    QAction *foldAction = new QAction("Fold", this);
+    QAction *unfoldAction = new QAction("Unfold", this);
+    QAction *unfoldAllAction = new QAction("Unfold All", this);
+    foldAction->setShortcut(QKeySequence("Ctrl+Shift+["));
+    unfoldAction->setShortcut(QKeySequence("Ctrl+Shift+]"));
+    connect(foldAction, &QAction::triggered, this, [this]() {
+        if (CodeEditor *editor = currentEditor())
+            editor->foldAtCursor();
+    });
+    connect(unfoldAction, &QAction::triggered, this, [this]() {
+        if (CodeEditor *editor = currentEditor())
+            editor->unfoldAtCursor();
+    });
+    connect(unfoldAllAction, &QAction::triggered, this, [this]() {
+        if (CodeEditor *editor = currentEditor())
+            editor->unfoldAll();
+    });
+    viewMenu->addSeparator();
+    viewMenu->addAction(foldAction);
+    viewMenu->addAction(unfoldAction);
+    viewMenu->addAction(unfoldAllAction);
+
+    // Folder search hits are picked up in batches rather than one event per file
+    folderSearchTimer.setInterval(50);
+    connect(&folderSearchTimer, &QTimer::timeout, this, &MainWindow::drainFolderSearch);
+
+    // A log being written gets one reload per interval rather than one per write
+    connect(&fileWatcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::fileChanged);
+    fileChangeTimer.setSingleShot(true);
+    fileChangeTimer.setInterval(100);
+    connect(&fileChangeTimer, &QTimer::timeout, this, &MainWindow::processChangedFiles);
+
+    // Journals that have grown are rewritten as one delta every half minute
+    journalRoot = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/journal";
+    journalCompactTimer.setInterval(30 * 1000);
+    connect(&journalCompactTimer, &QTimer::timeout, this, &MainWindow::compactJournals);
+    journalCompactTimer.start();
+
+    // Refreshes the memory report and checks the budget
+    memoryTimer.setInterval(5 * 1000);
+    connect(&memoryTimer, &QTimer::timeout, this, &MainWindow::checkMemory);
+    memoryTimer.start();
+#if defined(Q_OS_MACOS)
+    // Delivered on the main queue, which is the GUI thread
+    memoryPressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                                  DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                                  dispatch_get_main_queue());
+    dispatch_set_context(memoryPressureSource, this);
+    dispatch_source_set_event_handler_f(memoryPressureSource, &MainWindow::memoryPressureEvent);
+    dispatch_resume(memoryPressureSource);
+#endif
+}
+
+MainWindow::~MainWindow() {
+#if defined(Q_OS_MACOS)
+    dispatch_source_cancel(memoryPressureSource);
+    dispatch_release(memoryPressureSource);
+#endif
+    // Unblock loaders waiting for the GUI thread so the thread pool can shut down
+    for (FileLoadJob *job : std::as_const(loadJobs)) {
+        job->cancel();
+    }
+    cancelSearches();
+    // Let background saves reach their commit before the process exits
+    savePool()->waitForDone();
+
+    // Journals still here hold unsaved edits and stay for the next launch to offer;
+    // the directory only goes once it is empty
+    if (journalLock) {
+        journalLock->unlock();
+        QDir().rmdir(journalDirectory);
+    }
+}
+
+CodeEditor* MainWindow::currentEditor() {
+    return qobject_cast<CodeEditor*>(tabWidget->currentWidget());
+}
+
+FindReplaceDialog *MainWindow::findDialog() {
+    if (!findReplaceDialog) {
+        findReplaceDialog = new FindReplaceDialog(this);
+        connect(findReplaceDialog, &FindReplaceDialog::findText, this, &MainWindow::findText);
+        connect(findReplaceDialog, &FindReplaceDialog::findPreviousText, this, &MainWindow::findPreviousText);
+        connect(findReplaceDialog, &FindReplaceDialog::replaceText, this, &MainWindow::replaceText);
+        connect(findReplaceDialog, &FindReplaceDialog::replaceAllText, this, &MainWindow::replaceAllText);
+        connect(findReplaceDialog, &FindReplaceDialog::findInAllTabsText, this, &MainWindow::findInAllTabs);
+        connect(findReplaceDialog, &FindReplaceDialog::findInFolderText, this, &MainWindow::findInFolder);
+    }
+    return findReplaceDialog;
+}
+
+void MainWindow::showPerformancePanel() {
+    if (!performanceDock) {
+        performanceDock = new QDockWidget("Performance", this);
+        performancePanel = new PerformancePanel(performanceDock);
+        performanceDock->setWidget(performancePanel);
+        addDockWidget(Qt::RightDockWidgetArea, performanceDock);
+        connect(performancePanel, &PerformancePanel::trimMemoryRequested, this, [this]() {
+            relieveMemoryPressure(false);
+            performancePanel->setMemoryReport(memoryReport());
+        });
+    }
+    performanceDock->show();
+    performanceDock->raise();
+    performancePanel->setMemoryReport(memoryReport());
+}
+
+qint64 MainWindow::memoryLimit() {
+    // Above this many MiB of estimated use, memory is given back as if the system asked; 0 turns it off
+    QSettings settings;
+    return settings.value("memory/limitMB", 0).toLongLong() * 1024 * 1024;
+}
+
+qint64 MainWindow::accountedMemory() {
+    qint64 total = 0;
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        if (CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(i)))
+            total += editor->memoryUse().total();
+        else if (HibernatedTab *tab = qobject_cast<HibernatedTab*>(tabWidget->widget(i)))
+            total += tab->text.size();
+    }
+    return total;
+}
+
+void MainWindow::checkMemory() {
+    // The editors are only walked when the report is on screen or a budget is set
+    const qint64 limit = memoryLimit();
+    const bool reporting = performanceDock && performanceDock->isVisible();
+    if (limit > 0 && accountedMemory() > limit) {
+        relieveMemoryPressure(false);
+        if (accountedMemory() > limit)
+            relieveMemoryPressure(true);
+    }
+    if (reporting)
+        performancePanel->setMemoryReport(memoryReport());
+}
+
+QString MainWindow::memoryReport() {
+    const QLocale locale;
+    auto size = [&locale](qint64 bytes) { return locale.formattedDataSize(bytes); };
+    QString report = QString("%1 %2 %3 %4 %5 %6\n").arg("Tab", -24).arg("Document", 10).arg("Highlight", 10)
+                     .arg("Search", 10).arg("Undo", 10).arg("Total", 10);
+
+    MemoryUse sum;
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        MemoryUse use;
+        if (CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(i)))
+            use = editor->memoryUse();
+        else if (HibernatedTab *tab = qobject_cast<HibernatedTab*>(tabWidget->widget(i)))
+            use.document = tab->text.size();
+        else
+            continue;
+        sum.document += use.document;
+        sum.highlighter += use.highlighter;
+        sum.searchIndex += use.searchIndex;
+        sum.undo += use.undo;
+        report += QString("%1 %2 %3 %4 %5 %6\n").arg(tabWidget->tabText(i).left(24), -24)
+                  .arg(size(use.document), 10).arg(size(use.highlighter), 10).arg(size(use.searchIndex), 10)
+                  .arg(size(use.undo), 10).arg(size(use.total()), 10);
+    }
+    report += QString("%1 %2 %3 %4 %5 %6\n").arg("All tabs", -24).arg(size(sum.document), 10)
+              .arg(size(sum.highlighter), 10).arg(size(sum.searchIndex), 10).arg(size(sum.undo), 10)
+              .arg(size(sum.total()), 10);
+    return report;
+}
+
+void MainWindow::relieveMemoryPressure(bool critical) {
+    PerfScope perf("MainWindow::relieveMemoryPressure");
+
+    // Cheapest to lose first: search indices are rebuilt on the next find, then undo history
+    // goes, and only when memory is critically short are whole tabs hibernated, biggest first.
+    // Unsaved tabs keep their undo history unless memory is critically short, since it is
+    // the only way back to the text on disk. The current tab is left alone.
+    QList<CodeEditor*> background;
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(i));
+        if (editor && editor != tabWidget->currentWidget() && !editor->isBulkInserting())
+            background.append(editor);
+    }
+    for (CodeEditor *editor : std::as_const(background)) {
+        editor->dropSearchIndex();
+    }
+    for (CodeEditor *editor : std::as_const(background)) {
+        if (critical || !editor->document()->isModified())
+            editor->trimUndo();
+    }
+    if (!critical)
+        return;
+
+    QList<std::pair<qint64, CodeEditor*>> bySize;
+    for (CodeEditor *editor : std::as_const(background)) {
+        bySize.append({editor->memoryUse().total(), editor});
+    }
+    std::sort(bySize.begin(), bySize.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    for (const auto &entry : std::as_const(bySize)) {
+        hibernateTab(tabWidget->indexOf(entry.second));
+    }
+}
+
+#if defined(Q_OS_MACOS)
+void MainWindow::memoryPressureEvent(void *context) {
+    MainWindow *window = static_cast<MainWindow *>(context);
+    const unsigned long level = dispatch_source_get_data(window->memoryPressureSource);
+    window->relieveMemoryPressure(level & DISPATCH_MEMORYPRESSURE_CRITICAL);
+}
+#endif
+
+void MainWindow::openStartupDocument() {
+    if (tabWidget->count() > 0)
+        return;
+
+    newDocument();
+    startupDocument = currentEditor();
+}
+
+void MainWindow::replaceStartupDocument() {
+    CodeEditor *editor = startupDocument;
+    startupDocument = nullptr;
+    if (!editor || editor->document()->isModified() || !editor->document()->isEmpty())
+        return;
+
+    int index = tabWidget->indexOf(editor);
+    if (index != -1) {
+        tabWidget->removeTab(index);
+        editor->deleteLater();
+    }
+}
+
+void MainWindow::newDocument() {
+    // Create a new CodeEditor; the highlighter waits until there is text to highlight
+    CodeEditor *editor = new CodeEditor(this);
+    connect(editor->document(), &QTextDocument::contentsChanged, editor, [this, editor]() {
+        attachHighlighter(editor, editor->property("filePath").toString(), 0);
+    }, Qt::SingleShotConnection);
+    if (pieceTableEnabled()) {
+        editor->enablePieceTable();
+    }
+    if (minimapEnabled()) {
+        editor->showMinimap();
+    }
+    trackEdits(editor);
+
+    // Add to tab widget
+    QString displayName = "Untitled";
+    tabWidget->addTab(editor, displayName);
+    tabWidget->setCurrentWidget(editor);
+
+    // No file path yet
+    editor->setProperty("filePath", QString());
+}
+
+void MainWindow::openFile() {
+    QString fileName = QFileDialog::getOpenFileName(this, "Open File", "",
+                                                    "Text Files (*.txt *.cpp *.h *.py *.md);;All Files (*)");
+    if (!fileName.isEmpty()) {
+        openFileFromEvent(fileName);
+    }
+}
+
+void MainWindow::openFileFromEvent(const QString &fileName) {
+    PerfScope perf("MainWindow::openFileFromEvent");
+
+    // Check if file is already open
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        if (tabWidget->widget(i)->property("filePath").toString() == fileName) {
+            tabWidget->setCurrentIndex(i);
+            return;
+        }
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, "Error", "Could not open file");
+        return;
+    }
+    qint64 fileSize = file.size();
+    file.close();
+
+    if (fileSize >= largeFileThreshold()) {
+        openInViewer(fileName);
+        return;
+    }
+
+    CodeEditor *editor = createEditor();
+
+    // Add to tab widget
+    QString displayName = QFileInfo(fileName).fileName();
+    tabWidget->addTab(editor, displayName);
+    tabWidget->setCurrentWidget(editor);
+    replaceStartupDocument();
+
+    startLoading(editor, fileName);
+}
+
+CodeEditor *MainWindow::createEditor() {
+    CodeEditor *editor = new CodeEditor(this);
+    QFont emojiFont("Apple Color Emoji");
+    emojiFont.setPointSize(12);  // Adjust the size as needed
+    editor->setFont(emojiFont);
+    if (pieceTableEnabled()) {
+        editor->enablePieceTable();
+    }
+    if (minimapEnabled()) {
+        editor->showMinimap();
+    }
+    trackEdits(editor);
+    return editor;
+}
+
+void MainWindow::startLoading(CodeEditor *editor, const QString &fileName, const QVariant &knownFormat) {
+    // The editor stays read-only until the last chunk has been appended
+    editor->setReadOnly(true);
+    editor->document()->setUndoRedoEnabled(false);
+    SyntaxHighlighter *highlighter = attachHighlighter(editor, fileName, QFileInfo(fileName).size());
+    if (highlighter)
+        highlighter->setLoading(true);
+
+    // Store the file path as property
+    QString displayName = QFileInfo(fileName).fileName();
+    editor->setProperty("filePath", fileName);
+
+    FileLoadJob *job = knownFormat.isValid() ? new FileLoadJob(fileName, 0, knownFormat.value<TextFormat>())
+                                             : new FileLoadJob(fileName);
+    loadJobs.insert(editor, job);
+
+    connect(job, &FileLoadJob::chunkReady, editor,
+            [this, editor, highlighter, job, displayName](const QString &text, qint64 bytesRead, qint64 totalBytes) {
+        editor->appendText(text);
+        editor->document()->setModified(false);
+        if (highlighter)
+            highlighter->setLoading(true);
+        job->chunkConsumed();
+
+        int index = tabWidget->indexOf(editor);
+        if (index != -1 && totalBytes > 0) {
+            int percent = static_cast<int>(bytesRead * 100 / totalBytes);
+            tabWidget->setTabText(index, QString("%1 (%2%)").arg(displayName).arg(percent));
+        }
+    }, Qt::QueuedConnection);
+
+    connect(job, &FileLoadJob::restarted, editor, [editor]() {
+        editor->clear();
+        editor->document()->setModified(false);
+    }, Qt::QueuedConnection);
+
+    connect(job, &FileLoadJob::finished, editor, [this, editor, highlighter, job, displayName, fileName]() {
+        loadJobs.remove(editor);
+        editor->setProperty("textFormat", QVariant::fromValue(job->format));
+        recordDiskState(editor, fileName, job->bytesLoaded);
+        editor->setReadOnly(false);
+        editor->document()->setUndoRedoEnabled(true);
+        editor->document()->setModified(false); // Reset modified flag
+        if (highlighter)
+            highlighter->setLoading(false);
+
+        int index = tabWidget->indexOf(editor);
+        if (index != -1) {
+            tabWidget->setTabText(index, displayName);
+        }
+
+        // Requested by a Find in Folder hit while the file was loading
+        QVariant pendingLine = editor->property("pendingLine");
+        if (pendingLine.isValid()) {
+            editor->setProperty("pendingLine", QVariant());
+            goToLine(editor, pendingLine.toLongLong());
+        }
+        // Saved when the tab was hibernated
+        QVariant viewState = editor->property("pendingViewState");
+        if (viewState.isValid()) {
+            editor->setProperty("pendingViewState", QVariant());
+            restoreViewState(editor, viewState.toList());
+        }
+        // Unsaved edits recovered after a crash
+        QVariant journalPath = editor->property("pendingJournal");
+        if (journalPath.isValid()) {
+            editor->setProperty("pendingJournal", QVariant());
+            replayJournal(editor, journalPath.toString());
+        }
+    }, Qt::QueuedConnection);
+    // Connected last so the deferred delete is queued behind the handlers above
+    connect(job, &FileLoadJob::finished, job, &QObject::deleteLater);
+
+    QThreadPool::globalInstance()->start(job);
+}
+
+QByteArray MainWindow::diskTail(const QString &fileName, qint64 size) {
+    // The last bytes before the recorded end tell an append apart from a rewrite
+    const qint64 tailSize = 4096;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(qMax<qint64>(0, size - tailSize)))
+        return QByteArray();
+    return file.read(qMin(size, tailSize));
+}
+
+void MainWindow::recordDiskState(QWidget *tab, const QString &fileName, qint64 size) {
+    tab->setProperty("diskSize", size);
+    tab->setProperty("diskTail", diskTail(fileName, size));
+    tab->setProperty("diskModified", QFileInfo(fileName).lastModified());
+    watchFile(fileName);
+    // Writes that landed while the tab was catching up are picked up straight away
+    changedFiles.insert(fileName);
+    fileChangeTimer.start();
+}
+
+void MainWindow::watchFile(const QString &fileName) {
+    if (!fileWatcher.files().contains(fileName))
+        fileWatcher.addPath(fileName);
+}
+
+void MainWindow::unwatchFile(const QString &fileName) {
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        if (tabWidget->widget(i)->property("filePath").toString() == fileName)
+            return;
+    }
+    fileWatcher.removePath(fileName);
+}
+
+void MainWindow::fileChanged(const QString &fileName) {
+    changedFiles.insert(fileName);
+    if (!fileChangeTimer.isActive())
+        fileChangeTimer.start();
+}
+
+void MainWindow::processChangedFiles() {
+    const QSet<QString> fileNames = std::exchange(changedFiles, QSet<QString>());
+    for (const QString &fileName : fileNames) {
+        // Gone, or half-way through an atomic save; the replacement brings its own change
+        QFileInfo info(fileName);
+        if (!info.exists())
+            continue;
+        // Replacing the file drops the watch on the old one
+        watchFile(fileName);
+
+        for (int i = 0; i < tabWidget->count(); ++i) {
+            QWidget *tab = tabWidget->widget(i);
+            QVariant diskSize = tab->property("diskSize");
+            if (!diskSize.isValid() || tab->property("filePath").toString() != fileName)
+                continue;
+
+            const qint64 knownSize = diskSize.toLongLong();
+            if (info.size() == knownSize && info.lastModified() == tab->property("diskModified").toDateTime())
+                continue;
+            const bool appended = info.size() >= knownSize
+                                  && diskTail(fileName, knownSize) == tab->property("diskTail").toByteArray();
+
+            if (LargeFileViewer *viewer = qobject_cast<LargeFileViewer*>(tab)) {
+                if (viewer->reload(appended))
+                    recordDiskState(viewer, fileName, viewer->fileSize());
+            } else if (CodeEditor *editor = qobject_cast<CodeEditor*>(tab)) {
+                // Unsaved edits are never overwritten; the next save decides what the file holds
+                if (editor->document()->isModified() || loadJobs.contains(editor) || saveJobs.contains(editor)
+                    || reloadJobs.contains(editor)) {
+                    continue;
+                }
+                // Streaming the tail in turns undo off, which would clear any history the tab
+                // has; with history the growth goes in as one undoable edit like a rewrite
+                QTextDocument *document = editor->document();
+                if (appended && !document->isUndoAvailable() && !document->isRedoAvailable())
+                    appendFromDisk(editor, fileName, knownSize);
+                else
+                    reloadFromDisk(editor, fileName);
+            }
+        }
+    }
+}
+
+void MainWindow::appendFromDisk(CodeEditor *editor, const QString &fileName, qint64 offset) {
+    // Unmodified, so any journal only holds edits that were undone, and its base is changing
+    discardJournal(editor);
+    FileLoadJob *job = new FileLoadJob(fileName, offset, editor->property("textFormat").value<TextFormat>());
+    loadJobs.insert(editor, job);
+    // Text that arrived on disk isn't an edit to undo; only called with empty undo stacks,
+    // since turning undo off clears them
+    editor->document()->setUndoRedoEnabled(false);
+    SyntaxHighlighter *highlighter = editor->document()->findChild<SyntaxHighlighter*>();
+    if (highlighter) {
+        highlighter->highlightLazily(editor, editor->document()->blockCount() - 1);
+        highlighter->setLoading(true);
+    }
+
+    connect(job, &FileLoadJob::chunkReady, editor, [editor, highlighter, job](const QString &text) {
+        // A view at the end follows the file like tail -f; anywhere else it stays put
+        QScrollBar *bar = editor->verticalScrollBar();
+        const bool following = bar->value() >= bar->maximum();
+        editor->appendText(text);
+        editor->document()->setModified(false);
+        if (highlighter)
+            highlighter->setLoading(true);
+        job->chunkConsumed();
+        if (following)
+            bar->setValue(bar->maximum());
+    }, Qt::QueuedConnection);
+
+    connect(job, &FileLoadJob::finished, editor, [this, editor, highlighter, job, fileName, offset]() {
+        loadJobs.remove(editor);
+        editor->document()->setUndoRedoEnabled(true);
+        editor->document()->setModified(false);
+        if (highlighter)
+            highlighter->setLoading(false);
+        if (job->bytesLoaded >= offset)
+            recordDiskState(editor, fileName, job->bytesLoaded);
+    }, Qt::QueuedConnection);
+    // Connected last so the deferred delete is queued behind the handlers above
+    connect(job, &FileLoadJob::finished, job, &QObject::deleteLater);
+
+    QThreadPool::globalInstance()->start(job);
+}
+
+void MainWindow::reloadFromDisk(CodeEditor *editor, const QString &fileName) {
+    ReloadJob *job = new ReloadJob(fileName, editor->snapshot(), editor->document()->revision());
+    reloadJobs.insert(editor, job);
+
+    QPointer<CodeEditor> guard(editor);
+    connect(job, &ReloadJob::finished, this, [this, editor, guard, job]() {
+        reloadJobs.remove(editor);
+        if (!guard || !job->ok)
+            return;
+        // Typed into since the snapshot was taken: look again once it's saved or settles
+        if (guard->document()->revision() != job->revision) {
+            changedFiles.insert(job->fileName);
+            fileChangeTimer.start();
+            return;
+        }
+
+        // One undoable edit over the changed span; the scroll position is kept
+        QScrollBar *bar = guard->verticalScrollBar();
+        const int scroll = bar->value();
+        QTextCursor cursor(guard->document());
+        journalPaused = true;
+        cursor.beginEditBlock();
+        cursor.setPosition(job->prefix);
+        cursor.setPosition(job->prefix + job->removedLength, QTextCursor::KeepAnchor);
+        cursor.insertText(job->replacement);
+        cursor.endEditBlock();
+        journalPaused = false;
+        bar->setValue(scroll);
+        discardJournal(guard);
+
+        guard->document()->setModified(false);
+        guard->setProperty("textFormat", QVariant::fromValue(job->format));
+        recordDiskState(guard, job->fileName, job->bytesLoaded);
+    }, Qt::QueuedConnection);
+    // Connected last so the deferred delete is queued behind the handler above
+    connect(job, &ReloadJob::finished, job, &QObject::deleteLater);
+
+    QThreadPool::globalInstance()->start(job);
+}
+
+bool MainWindow::ensureJournalDirectory() {
+    if (journalLock)
+        return true;
+
+    // Named by process and start time, so a reused pid never lands in a crashed instance's directory
+    QString directory = QString("%1/%2-%3").arg(journalRoot).arg(QCoreApplication::applicationPid())
+                                           .arg(QDateTime::currentMSecsSinceEpoch());
+    if (!QDir().mkpath(directory))
+        return false;
+    // Only a dead owner makes the lock stale, however long this instance runs
+    auto lock = std::make_unique<QLockFile>(directory + "/lock");
+    lock->setStaleLockTime(0);
+    if (!lock->tryLock(0))
+        return false;
+    journalDirectory = directory;
+    journalLock = std::move(lock);
+    return true;
+}
+
+void MainWindow::trackEdits(CodeEditor *editor) {
+    connect(editor, &CodeEditor::edited, this, [this, editor](qint64 position, qint64 removed, const QString &text) {
+        journalEdit(editor, position, removed, text);
+    });
+    // Large pastes show their progress in the tab, like loads
+    connect(editor, &CodeEditor::bulkInsertProgress, this, [this, editor](int percent) {
+        int index = tabWidget->indexOf(editor);
+        if (index == -1)
+            return;
+        if (percent == 0)
+            editor->setProperty("bulkTabText", tabWidget->tabText(index));
+        const QString name = editor->property("bulkTabText").toString();
+        tabWidget->setTabText(index, percent < 100 ? QString("%1 (pasting %2%)").arg(name).arg(percent) : name);
+    });
+}
+
+void MainWindow::journalEdit(CodeEditor *editor, qint64 position, qint64 removed, const QString &text) {
+    // Loading, reloading and recovery change the text without it being edited
+    if (journalPaused || loadJobs.contains(editor))
+        return;
+
+    EditJournal *journal = journalOf(editor);
+    if (!journal)
+        journal = startJournal(editor);
+    if (journal)
+        journal->record(position, removed, text);
+}
+
+EditJournal *MainWindow::startJournal(CodeEditor *editor) {
+    if (!ensureJournalDirectory())
+        return nullptr;
+
+    EditJournal::Header header;
+    header.filePath = editor->property("filePath").toString();
+    if (!header.filePath.isEmpty()) {
+        header.baseSize = editor->property("diskSize").toLongLong();
+        header.baseModified = editor->property("diskModified").toDateTime();
+    }
+    header.format = editor->property("textFormat").value<TextFormat>();
+
+    EditJournal *journal = new EditJournal(QString("%1/%2.journal").arg(journalDirectory).arg(++journalCount), editor);
+    if (!journal->create(header)) {
+        journal->discard();
+        return nullptr;
+    }
+    return journal;
+}
+
+EditJournal *MainWindow::journalOf(QWidget *tab) {
+    return tab->findChild<EditJournal*>(QString(), Qt::FindDirectChildrenOnly);
+}
+
+void MainWindow::discardJournal(QWidget *tab) {
+    if (EditJournal *journal = journalOf(tab))
+        journal->discard();
+}
+
+void MainWindow::rebaseJournal(CodeEditor *editor) {
+    // The saved file is the new base; edits made while the save ran are carried over by
+    // compacting a fresh journal against it
+    discardJournal(editor);
+    if (editor->document()->isModified() && startJournal(editor))
+        compactJournal(editor);
+}
+
+void MainWindow::compactJournals() {
+    // Journals below this size aren't worth rewriting
+    const qint64 compactThreshold = 1 << 20;
+
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(i));
+        EditJournal *journal = editor ? journalOf(editor) : nullptr;
+        if (journal && journal->size() > compactThreshold)
+            compactJournal(editor);
+    }
+}
+
+void MainWindow::compactJournal(CodeEditor *editor) {
+    EditJournal *journal = journalOf(editor);
+    if (!journal || journal->isCompacting() || loadJobs.contains(editor))
+        return;
+
+    const PieceTable::Snapshot snapshot = editor->snapshot();
+    EditJournal::Header header = journal->header();
+    if (header.filePath.isEmpty()) {
+        // Without a base the delta is the whole text, which only pays off once the journal has outgrown it
+        if (journal->size() < 4 * snapshot.length())
+            return;
+        journal->beginCompaction();
+        journal->finishCompaction(header, EditJournal::Delta{0, 0, snapshot.text()});
+        return;
+    }
+
+    // ReloadJob diffs the text against the file on a worker; the delta is that diff reversed
+    journal->beginCompaction();
+    ReloadJob *job = new ReloadJob(header.filePath, snapshot, editor->document()->revision());
+    QPointer<EditJournal> guard(journal);
+    connect(job, &ReloadJob::finished, this, [guard, job, header]() mutable {
+        if (!guard)
+            return;
+        if (!job->ok) {
+            guard->cancelCompaction();
+            return;
+        }
+        header.baseSize = job->bytesLoaded;
+        header.baseModified = QFileInfo(header.filePath).lastModified();
+        guard->finishCompaction(header, EditJournal::Delta{job->prefix, job->replacement.size(),
+                                                           job->snapshot.mid(job->prefix, job->removedLength)});
+    }, Qt::QueuedConnection);
+    // Connected last so the deferred delete is queued behind the handler above
+    connect(job, &ReloadJob::finished, job, &QObject::deleteLater);
+
+    QThreadPool::globalInstance()->start(job);
+}
+
+void MainWindow::replayJournal(CodeEditor *editor, const QString &journalPath) {
+    EditJournal::Header header;
+    QList<EditJournal::Delta> deltas;
+    if (!EditJournal::read(journalPath, header, deltas)) {
+        QFile::remove(journalPath);
+        return;
+    }
+    if (!header.filePath.isEmpty() && editor->property("diskSize").toLongLong() != header.baseSize) {
+        QMessageBox::warning(this, "Recover",
+                             QString("'%1' changed on disk after the recovered edits were made; check them before saving.")
+                             .arg(QFileInfo(header.filePath).fileName()));
+    }
+
+    // One undoable edit, so the recovery itself can be taken back
+    journalPaused = true;
+    QTextCursor cursor(editor->document());
+    cursor.beginEditBlock();
+    for (const EditJournal::Delta &delta : std::as_const(deltas)) {
+        const qint64 end = editor->document()->characterCount() - 1;
+        cursor.setPosition(static_cast<int>(qBound<qint64>(0, delta.position, end)));
+        cursor.setPosition(static_cast<int>(qBound<qint64>(0, delta.position + delta.removed, end)),
+                           QTextCursor::KeepAnchor);
+        cursor.insertText(delta.text);
+    }
+    cursor.endEditBlock();
+    journalPaused = false;
+    editor->document()->setModified(true);
+
+    // Later edits go on into the same journal, which still has the same base
+    if (ensureJournalDirectory()) {
+        EditJournal *journal = new EditJournal(journalPath, editor);
+        if (!journal->resume())
+            journal->discard();
+    }
+}
+
+void MainWindow::recoverJournals() {
+    if (!ensureJournalDirectory())
+        return;
+
+    // Every running instance holds the lock in its own directory, so a lock that can be
+    // taken belonged to one that crashed. Its journals are moved here before it is let go.
+    QStringList journals;
+    QDir root(journalRoot);
+    for (const QString &name : root.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QDir directory(root.filePath(name));
+        if (directory.absolutePath() == QDir(journalDirectory).absolutePath())
+            continue;
+        QLockFile lock(directory.filePath("lock"));
+        lock.setStaleLockTime(0);
+        if (!lock.tryLock(0))
+            continue;
+        for (const QString &file : directory.entryList({"*.journal"}, QDir::Files, QDir::Name)) {
+            QString moved = QString("%1/%2.journal").arg(journalDirectory).arg(++journalCount);
+            if (QFile::rename(directory.filePath(file), moved))
+                journals.append(moved);
+        }
+        lock.unlock();
+        root.rmdir(name);
+    }
+    if (journals.isEmpty())
+        return;
+
+    QMessageBox::StandardButton reply = QMessageBox::question(
+        this, "Recover",
+        QString("%1 document(s) had unsaved changes when the editor last quit unexpectedly. Recover them?")
+        .arg(journals.size()));
+    for (const QString &journalPath : std::as_const(journals)) {
+        EditJournal::Header header;
+        QList<EditJournal::Delta> deltas;
+        if (reply != QMessageBox::Yes || !EditJournal::read(journalPath, header, deltas)) {
+            QFile::remove(journalPath);
+            continue;
+        }
+
+        CodeEditor *editor = createEditor();
+        if (header.filePath.isEmpty()) {
+            attachHighlighter(editor, QString(), 0);
+            editor->setProperty("filePath", QString());
+            editor->setProperty("textFormat", QVariant::fromValue(header.format));
+            tabWidget->addTab(editor, "Untitled (recovered)");
+            replayJournal(editor, journalPath);
+        } else if (QFileInfo::exists(header.filePath)) {
+            // The edits go in once the base has loaded
+            tabWidget->addTab(editor, QFileInfo(header.filePath).fileName());
+            editor->setProperty("pendingJournal", journalPath);
+            startLoading(editor, header.filePath);
+        } else {
+            delete editor;
+            QFile::remove(journalPath);
+            QMessageBox::warning(this, "Recover",
+                                 QString("'%1' no longer exists, so its unsaved changes can't be recovered.")
+                                 .arg(header.filePath));
+            continue;
+        }
+        tabWidget->setCurrentWidget(editor);
+    }
+}
+
+qint64 MainWindow::largeFileThreshold() {
+    // Files at least this big open in the read-only mmap viewer; set viewer/largeFileThreshold to change it
+    QSettings settings;
+    return settings.value("viewer/largeFileThreshold", qint64(256) * 1024 * 1024).toLongLong();
+}
+
+qint64 MainWindow::highlightSizeLimit() {
+    // Files bigger than this open without highlighting; set highlight/maxFileSize to change it
+    QSettings settings;
+    return settings.value("highlight/maxFileSize", qint64(32) * 1024 * 1024).toLongLong();
+}
+
+SyntaxHighlighter *MainWindow::attachHighlighter(CodeEditor *editor, const QString &fileName, qint64 size) {
+    const LanguageRegistry &registry = LanguageRegistry::instance();
+    const Language *language = fileName.isEmpty() ? registry.defaultLanguage() : registry.forFile(fileName);
+    if (size > highlightSizeLimit())
+        language = nullptr;
+
+    SyntaxHighlighter *current = editor->document()->findChild<SyntaxHighlighter*>();
+    if (current && current->language() == language)
+        return current;
+    if (current) {
+        // Deleting it clears its formats; the cached runs are the old language's
+        delete current;
+        for (QTextBlock block = editor->document()->firstBlock(); block.isValid(); block = block.next()) {
+            block.setUserData(nullptr);
+        }
+    }
+    if (!language)
+        return nullptr;
+
+    SyntaxHighlighter *highlighter = new SyntaxHighlighter(editor->document(), language);
+    highlighter->highlightLazily(editor);
+    return highlighter;
+}
+
+bool MainWindow::minimapEnabled() {
+    // Editors show a minimap unless editor/minimap is false
+    QSettings settings;
+    return settings.value("editor/minimap", true).toBool();
+}
+
+bool MainWindow::pieceTableEnabled() {
+    // Editors mirror their text into a piece table unless editor/pieceTable is false
+    QSettings settings;
+    return settings.value("editor/pieceTable", true).toBool();
+}
+
+LargeFileViewer *MainWindow::createViewer(const QString &fileName) {
+    LargeFileViewer *viewer = new LargeFileViewer(this);
+    QFont emojiFont("Apple Color Emoji");
+    emojiFont.setPointSize(12);
+    viewer->setFont(emojiFont);
+    if (!viewer->openFile(fileName)) {
+        delete viewer;
+        QMessageBox::warning(this, "Error", "Could not open file");
+        return nullptr;
+    }
+    viewer->setProperty("filePath", fileName);
+    recordDiskState(viewer, fileName, viewer->fileSize());
+    return viewer;
+}
+
+void MainWindow::openInViewer(const QString &fileName) {
+    LargeFileViewer *viewer = createViewer(fileName);
+    if (!viewer)
+        return;
+
+    QString displayName = QFileInfo(fileName).fileName() + " (read-only)";
+    tabWidget->addTab(viewer, displayName);
+    tabWidget->setCurrentWidget(viewer);
+    replaceStartupDocument();
+}
+
+// Takes on the name a save has just written to, so a failed Save As leaves the tab as it was
+void MainWindow::adoptFileName(CodeEditor *editor, const QString &fileName) {
+    // Update tab title
+    QString displayName = QFileInfo(fileName).fileName();
+    int index = tabWidget->indexOf(editor);
+    if (index != -1) {
+        tabWidget->setTabText(index, displayName);
+    }
+
+    // Update the filePath property
+    const QString previousFileName = editor->property("filePath").toString();
+    if (previousFileName == fileName) {
+        return;
+    }
+    editor->setProperty("filePath", fileName);
+    if (!previousFileName.isEmpty()) {
+        unwatchFile(previousFileName);
+    }
+    // A new extension may mean a different language
+    attachHighlighter(editor, fileName, QFileInfo(fileName).size());
+}
+
+bool MainWindow::saveToFile(CodeEditor *editor, const QString &fileName, bool wait) {
+    PerfScope perf("MainWindow::saveToFile");
+
+    if (fileName.isEmpty()) {
+        return false;
+    }
+
+    // Saving now would write a truncated file
+    if (loadJobs.contains(editor)) {
+        QMessageBox::information(this, "Save", "The file is still loading.");
+        return false;
+    }
+    if (editor->isBulkInserting()) {
+        QMessageBox::information(this, "Save", "The paste is still going in.");
+        return false;
+    }
+
+    // Keep saves of one tab in order; the newest request runs once the current one is done
+    if (saveJobs.contains(editor)) {
+        if (!wait) {
+            pendingSaves.insert(editor, fileName);
+            return true;
+        }
+        // This request supersedes any queued one; only this tab's save is waited on
+        pendingSaves.remove(editor);
+        SaveJob *running = saveJobs.value(editor);
+        if (savePool()->tryTake(running))
+            running->run();
+        else
+            running->wait();
+        saveJobs.remove(editor);
+    }
+
+    SaveJob *job = new SaveJob(editor->snapshot(), fileName, editor->property("textFormat").value<TextFormat>());
+    // The document stays modified until the save has succeeded, and after it if edited meanwhile
+    const int savedRevision = editor->document()->revision();
+
+    if (wait) {
+        job->run();
+        bool ok = job->ok;
+        if (ok) {
+            editor->document()->setModified(false);
+            adoptFileName(editor, fileName);
+            editor->setProperty("textFormat", QVariant::fromValue(job->format));
+            recordDiskState(editor, fileName, QFileInfo(fileName).size());
+            rebaseJournal(editor);
+        } else {
+            QMessageBox::warning(this, "Error", QString("Could not save file: %1").arg(job->errorString));
+        }
+        delete job;
+        return ok;
+    }
+
+    saveJobs.insert(editor, job);
+    QPointer<CodeEditor> guard(editor);
+    connect(job, &SaveJob::finished, this, [this, editor, guard, job, savedRevision]() {
+        // A save that waited for this one has already written newer text over it
+        if (saveJobs.value(editor) != job) {
+            return;
+        }
+        saveJobs.remove(editor);
+        QString nextFileName = pendingSaves.take(editor);
+
+        if (!job->ok) {
+            QMessageBox::warning(this, "Error", QString("Could not save file: %1").arg(job->errorString));
+        } else if (guard) {
+            if (guard->document()->revision() == savedRevision) {
+                guard->document()->setModified(false);
+            }
+            adoptFileName(guard, job->fileName);
+            // Latin-1 gives way to UTF-8 once the text no longer fits
+            guard->setProperty("textFormat", QVariant::fromValue(job->format));
+            // So the watcher doesn't take our own write for an outside change
+            recordDiskState(guard, job->fileName, QFileInfo(job->fileName).size());
+            rebaseJournal(guard);
+        }
+        if (guard && !nextFileName.isEmpty()) {
+            saveToFile(guard, nextFileName);
+        }
+    }, Qt::QueuedConnection);
+    // Connected last so the deferred delete is queued behind the handler above
+    connect(job, &SaveJob::finished, job, &QObject::deleteLater);
+
+    savePool()->start(job);
+    return true;
+}
+
+bool MainWindow::saveCurrentFile() {
+    CodeEditor *editor = currentEditor();
+    if (!editor)
+        return false;
+
+    QString fileName = editor->property("filePath").toString();
+    if (fileName.isEmpty()) {
+        return false;
+    }
+
+    return saveToFile(editor, fileName);
+}
+
+void MainWindow::saveFile() {
+    CodeEditor *editor = currentEditor();
+    if (!editor)
+        return;
+
+    QString fileName = editor->property("filePath").toString();
+    if (fileName.isEmpty()) {
+        saveFileAs();
+    } else {
+        saveToFile(editor, fileName);
+    }
+}
+
+void MainWindow::saveFileAs() {
+    CodeEditor *editor = currentEditor();
+    if (!editor)
+        return;
+
+    QString fileName = QFileDialog::getSaveFileName(this, "Save File As", "",
+                                                    "Text Files (*.txt *.cpp *.h *.py *.md);;All Files (*)");
+    if (!fileName.isEmpty()) {
+        saveToFile(editor, fileName);
+    }
+}
+
+void MainWindow::showFindReplaceDialog() {
+    FindReplaceDialog *dialog = findDialog();
+    dialog->show();
+    dialog->raise();
+    dialog->activateWindow();
+}
+
+const SearchQuery *MainWindow::compiledQuery(const QString &text) {
+    if (text.isEmpty())
+        return nullptr;
+
+    const SearchOptions options = findDialog()->options();
+    if (!lastQuery.isSameQuery(text, options)) {
+        lastQuery = SearchQuery(text, options);
+    }
+    if (!lastQuery.isValid()) {
+        QMessageBox::warning(this, "Find", QString("Invalid regular expression: %1").arg(lastQuery.errorString()));
+        return nullptr;
+    }
+    return &lastQuery;
+}
+
+SearchIndex *MainWindow::indexFor(CodeEditor *editor, const SearchQuery &query) {
+    SearchIndex *index = editor->searchIndex();
+    if (!index->query().isSameQuery(query.text(), query.options())) {
+        index->setQuery(query, editor->snapshot().text());
+    }
+    return index;
+}
+
+void MainWindow::findText(const QString &text) {
+    PerfScope perf("MainWindow::findText");
+
+    if (text.isEmpty())
+        return;
+
+    if (LargeFileViewer *viewer = qobject_cast<LargeFileViewer*>(tabWidget->currentWidget())) {
+        findInViewer(viewer, text, false);
+        return;
+    }
+
+    if (!findInEditor(text, false)) {
+        QMessageBox::information(this, "Find", QString("'%1' not found.").arg(text));
+    }
+}
+
+void MainWindow::findPreviousText(const QString &text) {
+    if (text.isEmpty())
+        return;
+
+    if (LargeFileViewer *viewer = qobject_cast<LargeFileViewer*>(tabWidget->currentWidget())) {
+        findInViewer(viewer, text, true);
+        return;
+    }
+
+    if (!findInEditor(text, true)) {
+        QMessageBox::information(this, "Find", QString("'%1' not found.").arg(text));
+    }
+}
+
+void MainWindow::findInViewer(LargeFileViewer *viewer, const QString &text, bool backward) {
+    const SearchOptions options = findDialog()->options();
+    if (options.regularExpression) {
+        QMessageBox::information(this, "Find", "The large file viewer only finds plain text.");
+        return;
+    }
+    const Qt::CaseSensitivity sensitivity = options.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    if (!ByteLiteralSearcher(text, sensitivity, viewer->encoding()).isValid()) {
+        QMessageBox::information(this, "Find", options.caseSensitive
+                                 ? QString("The file's encoding can't hold '%1'.").arg(text)
+                                 : QString("The large file viewer only ignores case in ASCII text; "
+                                           "turn on Match case to find this."));
+        return;
+    }
+    if (!viewer->find(text, options, backward)) {
+        QMessageBox::information(this, "Find", QString("'%1' not found.").arg(text));
+    }
+}
+
+bool MainWindow::findInEditor(const QString &text, bool backward) {
+    CodeEditor *editor = currentEditor();
+    if (!editor)
+        return true;
+    const SearchQuery *query = compiledQuery(text);
+    if (!query)
+        return true;
+
+    SearchIndex *index = indexFor(editor, *query);
+    QTextCursor cursor = editor->textCursor();
+    int match = backward ? index->previousMatch(cursor.selectionStart())
+                         : index->nextMatch(cursor.selectionEnd());
+    // A regex scan that ran out of time leaves the index short of the later matches
+    const QString incomplete = index->isComplete() ? QString() : QString(" (search timed out)");
+    if (match == -1) {
+        findDialog()->setMatchStatus(QString("%1 matches%2").arg(index->count()).arg(incomplete));
+        return false;
+    }
+
+    int position = index->matchPosition(match);
+    cursor.setPosition(position);
+    cursor.setPosition(position + index->matchLength(match), QTextCursor::KeepAnchor);
+    editor->setTextCursor(cursor);
+    findDialog()->setMatchStatus(QString("Match %1 of %2%3").arg(match + 1).arg(index->count()).arg(incomplete));
+    return true;
+}
+
+void MainWindow::replaceText(const QString &text, const QString &replacement) {
+    CodeEditor *editor = currentEditor();
+    if (!editor)
+        return;
+    const SearchQuery *query = compiledQuery(text);
+    if (!query)
+        return;
+
+    // Only a selection that is exactly one of the matches is replaced
+    SearchIndex *index = indexFor(editor, *query);
+    QTextCursor cursor = editor->textCursor();
+    const int start = cursor.selectionStart();
+    const int length = cursor.selectionEnd() - start;
+    const int match = index->nextMatch(start);
+    if (cursor.hasSelection() && match != -1 && index->matchPosition(match) == start
+        && index->matchLength(match) == length) {
+        // Capture groups come from matching again within the blocks around the selection
+        QRegularExpressionMatch groups;
+        if (query->options().regularExpression) {
+            QTextCursor blocks(editor->document());
+            blocks.setPosition(editor->document()->findBlock(start).position());
+            blocks.setPosition(cursor.selectionEnd(), QTextCursor::KeepAnchor);
+            blocks.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
+            QString window = blocks.selectedText();
+            window.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+            groups = query->matchAt(window, start - blocks.selectionStart(), length);
+        }
+        cursor.insertText(query->substitute(replacement, groups));
+    }
+    // Find next occurrence
+    findText(text);
+}
+
+void MainWindow::replaceAllText(const QString &text, const QString &replacement) {
+    PerfScope perf("MainWindow::replaceAllText");
+
+    CodeEditor *editor = currentEditor();
+    if (!editor)
+        return;
+    const SearchQuery *query = compiledQuery(text);
+    if (!query)
+        return;
+
+    if (loadJobs.contains(editor)) {
+        QMessageBox::information(this, "Replace All", "The file is still loading.");
+        return;
+    }
+    if (editor->isBulkInserting()) {
+        QMessageBox::information(this, "Replace All", "The paste is still going in.");
+        return;
+    }
+
+    int occurrences = editor->replaceAll(*query, replacement);
+    if (occurrences == -1) {
+        QMessageBox::warning(this, "Replace All", QString("Matching '%1' took longer than %2 s, nothing was replaced.")
+                             .arg(text).arg(SearchQuery::timeLimitMs / 1000));
+        return;
+    }
+    if (occurrences == 0) {
+        QMessageBox::information(this, "Replace All", QString("No occurrences of '%1' found.").arg(text));
+        return;
+    }
+
+    QMessageBox::information(this, "Replace All", QString("Replaced %1 occurrences of '%2' with '%3'.")
+                             .arg(occurrences).arg(text).arg(replacement));
+}
+
+void MainWindow::findInAllTabs(const QString &text) {
+    // Characters of a document searched per job
+    const qint64 chunkLength = 1 << 20;
+
+    const SearchQuery *query = compiledQuery(text);
+    if (!query)
+        return;
+
+    showSearchResults();
+    cancelSearches();
+    std::shared_ptr<QAtomicInt> cancelled = std::make_shared<QAtomicInt>(0);
+    allTabsSearchCancel = cancelled;
+    allTabsPendingJobs = 0;
+    allTabsMatchCount = 0;
+
+    struct TabSearch {
+        CodeEditor *editor;
+        PieceTable::Snapshot snapshot;
+        int revision;
+        qint64 next;
+    };
+    QList<TabSearch> tabs;
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(i));
+        if (editor) {
+            tabs.append(TabSearch{editor, editor->snapshot(), editor->document()->revision(), 0});
+        }
+    }
+
+    // Queue chunks round-robin across tabs so one huge tab can't starve the others
+    for (bool queued = true; queued; ) {
+        queued = false;
+        for (TabSearch &tab : tabs) {
+            if (tab.next >= tab.snapshot.length())
+                continue;
+
+            ChunkSearchJob *job = new ChunkSearchJob(tab.snapshot, tab.next,
+                                                     qMin(chunkLength, tab.snapshot.length() - tab.next),
+                                                     *query, cancelled);
+            job->tab = tab.editor;
+            job->revision = tab.revision;
+            connect(job, &ChunkSearchJob::finished, this, [this, job, cancelled]() {
+                if (cancelled == allTabsSearchCancel) {
+                    addAllTabsResults(job);
+                }
+            }, Qt::QueuedConnection);
+            // Connected last so the deferred delete is queued behind the handler above
+            connect(job, &ChunkSearchJob::finished, job, &QObject::deleteLater);
+            searchPool()->start(job);
+
+            ++allTabsPendingJobs;
+            tab.next += chunkLength;
+            queued = true;
+        }
+    }
+    updateSearchResultsTitle();
+}
+
+void MainWindow::addAllTabsResults(const ChunkSearchJob *job) {
+    // Keeps the list responsive for queries that match nearly every line
+    const int maxResults = 10000;
+
+    --allTabsPendingJobs;
+
+    // Drop results for tabs closed or edited since the search started
+    CodeEditor *editor = qobject_cast<CodeEditor*>(job->tab);
+    int index = tabWidget->indexOf(job->tab);
+    if (index != -1 && editor && editor->document()->revision() == job->revision) {
+        for (qsizetype i = 0; i < job->matches.size(); ++i) {
+            if (allTabsMatchCount >= maxResults)
+                break;
+
+            const qint64 position = job->matches.at(i);
+            QTextBlock block = editor->document()->findBlock(static_cast<int>(position));
+            QListWidgetItem *item = new QListWidgetItem(QString("%1:%2: %3")
+                                                        .arg(tabWidget->tabText(index))
+                                                        .arg(block.blockNumber() + 1)
+                                                        .arg(block.text().trimmed().left(200)));
+            item->setData(Qt::UserRole, QVariant::fromValue(reinterpret_cast<quintptr>(job->tab)));
+            item->setData(Qt::UserRole + 1, position);
+            item->setData(Qt::UserRole + 4, job->matchLengths.at(i));
+            searchResultsList->addItem(item);
+            ++allTabsMatchCount;
+        }
+    }
+    updateSearchResultsTitle();
+}
+
+void MainWindow::updateSearchResultsTitle() {
+    bool searching = allTabsPendingJobs > 0 || folderSearch;
+    searchResultsDock->setWindowTitle(QString("Search Results: %1 matches%2")
+                                      .arg(searchResultsList->count())
+                                      .arg(searching ? " (searching...)" : ""));
+}
+
+void MainWindow::showSearchResults() {
+    if (!searchResultsDock) {
+        searchResultsDock = new QDockWidget(this);
+        searchResultsList = new QListWidget(searchResultsDock);
+        searchResultsDock->setWidget(searchResultsList);
+        addDockWidget(Qt::BottomDockWidgetArea, searchResultsDock);
+        connect(searchResultsList, &QListWidget::itemActivated, this, &MainWindow::openSearchResult);
+        connect(searchResultsList, &QListWidget::itemClicked, this, &MainWindow::openSearchResult);
+    }
+    searchResultsDock->show();
+    searchResultsList->clear();
+}
+
+void MainWindow::cancelSearches() {
+    // Results of the previous search still in the queue are dropped
+    if (allTabsSearchCancel) {
+        allTabsSearchCancel->storeRelaxed(1);
+        allTabsSearchCancel.reset();
+    }
+    allTabsPendingJobs = 0;
+    if (folderSearch) {
+        folderSearch->cancel();
+        folderSearch.reset();
+    }
+    folderSearchTimer.stop();
+}
+
+QStringList MainWindow::folderIgnorePatterns() {
+    // Names of files and directories Find in Folder skips; set search/ignorePatterns to change them
+    QSettings settings;
+    return settings.value("search/ignorePatterns",
+                          QString(".git;.svn;.hg;node_modules;build;*.o;*.obj;*.a;*.so;*.dylib;"
+                                  "*.png;*.jpg;*.gif;*.pdf;*.zip")).toString().split(';', Qt::SkipEmptyParts);
+}
+
+void MainWindow::findInFolder(const QString &text) {
+    if (text.isEmpty())
+        return;
+
+    QSettings settings;
+    QString root = QFileDialog::getExistingDirectory(this, "Find in Folder",
+                                                     settings.value("search/lastFolder").toString());
+    if (root.isEmpty())
+        return;
+    settings.setValue("search/lastFolder", root);
+
+    showSearchResults();
+    cancelSearches();
+
+    folderSearch = std::make_shared<FolderSearch>(root, text, findDialog()->options(), folderIgnorePatterns());
+    std::shared_ptr<FolderSearch> search = folderSearch;
+    QThreadPool::globalInstance()->start([search]() { walkFolder(search); });
+    folderSearchTimer.start();
+    updateSearchResultsTitle();
+}
+
+void MainWindow::drainFolderSearch() {
+    if (!folderSearch)
+        return;
+
+    // Checked before taking the hits so none are left behind once the search is done
+    bool done = folderSearch->isDone();
+    QList<FolderSearchHit> hits;
+    {
+        QMutexLocker locker(&folderSearch->mutex);
+        hits.swap(folderSearch->hits);
+    }
+
+    QDir root(folderSearch->root);
+    for (const FolderSearchHit &hit : std::as_const(hits)) {
+        QListWidgetItem *item = new QListWidgetItem(QString("%1:%2: %3")
+                                                    .arg(root.relativeFilePath(hit.path))
+                                                    .arg(hit.line)
+                                                    .arg(hit.text));
+        item->setData(Qt::UserRole + 2, hit.path);
+        item->setData(Qt::UserRole + 3, hit.line);
+        searchResultsList->addItem(item);
+    }
+
+    if (done) {
+        folderSearch.reset();
+        folderSearchTimer.stop();
+    }
+    updateSearchResultsTitle();
+}
+
+void MainWindow::goToLine(QWidget *tab, qint64 line) {
+    if (LargeFileViewer *viewer = qobject_cast<LargeFileViewer*>(tab)) {
+        viewer->goToLine(line - 1);
+        return;
+    }
+
+    CodeEditor *editor = qobject_cast<CodeEditor*>(tab);
+    if (!editor)
+        return;
+    // The loader jumps there once the whole file is in
+    if (loadJobs.contains(editor)) {
+        editor->setProperty("pendingLine", line);
+        return;
+    }
+
+    QTextBlock block = editor->document()->findBlockByNumber(static_cast<int>(line - 1));
+    if (!block.isValid())
+        return;
+    editor->setTextCursor(QTextCursor(block));
+    editor->centerCursor();
+    editor->setFocus();
+}
+
+void MainWindow::openSearchResult(QListWidgetItem *item) {
+    // Find in Folder hits carry a path and line instead of a tab
+    QString path = item->data(Qt::UserRole + 2).toString();
+    if (!path.isEmpty()) {
+        openFileFromEvent(path);
+        QWidget *tab = tabWidget->currentWidget();
+        if (tab && tab->property("filePath").toString() == path) {
+            goToLine(tab, item->data(Qt::UserRole + 3).toLongLong());
+        }
+        return;
+    }
+
+    // The tab may have been closed since; only compare the stored pointer with live tabs
+    quintptr tab = item->data(Qt::UserRole).value<quintptr>();
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        if (reinterpret_cast<quintptr>(tabWidget->widget(i)) != tab)
+            continue;
+
+        CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(i));
+        if (!editor)
+            return;
+        tabWidget->setCurrentIndex(i);
+        int position = static_cast<int>(item->data(Qt::UserRole + 1).toLongLong());
+        QTextCursor cursor = editor->textCursor();
+        cursor.setPosition(position);
+        cursor.setPosition(position + item->data(Qt::UserRole + 4).toInt(), QTextCursor::KeepAnchor);
+        editor->setTextCursor(cursor);
+        editor->setFocus();
+        return;
+    }
+}
+
+int MainWindow::hibernateAfterMinutes() {
+    // Background tabs are unloaded after this long; set tabs/hibernateAfterMinutes to 0 to turn it off
+    QSettings settings;
+    return settings.value("tabs/hibernateAfterMinutes", 10).toInt();
+}
+
+void MainWindow::tabChanged(int /* index */) {
+    if (wakingTab)
+        return;
+
+    QWidget *current = tabWidget->currentWidget();
+    if (current == activeTab)
+        return;
+    if (activeTab) {
+        activeTab->setProperty("lastActive", uptime.elapsed());
+    }
+    activeTab = current;
+
+    if (qobject_cast<HibernatedTab*>(current)) {
+        wakeTab(tabWidget->currentIndex());
+    }
+}
+
+void MainWindow::hibernateIdleTabs() {
+    const int minutes = hibernateAfterMinutes();
+    if (minutes <= 0)
+        return;
+
+    const qint64 now = uptime.elapsed();
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(i));
+        if (!editor || editor == tabWidget->currentWidget())
+            continue;
+        // Tabs opened in the background start their idle time now
+        QVariant lastActive = editor->property("lastActive");
+        if (!lastActive.isValid()) {
+            editor->setProperty("lastActive", now);
+            continue;
+        }
+        if (now - lastActive.toLongLong() >= qint64(minutes) * 60 * 1000) {
+            hibernateTab(i);
+        }
+    }
+}
+
+void MainWindow::hibernateTab(int index) {
+    CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(index));
+    // The loader and background saves hold on to the editor, and a bulk insert is still filling it
+    if (!editor || loadJobs.contains(editor) || saveJobs.contains(editor) || pendingSaves.contains(editor)
+        || reloadJobs.contains(editor) || editor->isBulkInserting())
+        return;
+
+    HibernatedTab *tab = new HibernatedTab(this);
+    tab->filePath = editor->property("filePath").toString();
+    tab->modified = editor->document()->isModified();
+    if (!tab->reloadsFromDisk()) {
+        tab->text = editor->snapshot().text().toUtf8();
+    }
+    tab->viewState = viewState(editor);
+    tab->textFormat = editor->property("textFormat");
+    tab->setProperty("filePath", tab->filePath);
+    if (EditJournal *journal = journalOf(editor)) {
+        journal->flush();
+        journal->setParent(tab);
+    }
+
+    if (SyntaxHighlighter *highlighter = editor->document()->findChild<SyntaxHighlighter*>()) {
+        highlighter->cancelLazyHighlighting();
+    }
+    QString title = tabWidget->tabText(index);
+    wakingTab = true;
+    tabWidget->removeTab(index);
+    tabWidget->insertTab(index, tab, title);
+    wakingTab = false;
+    editor->deleteLater();
+}
+
+void MainWindow::wakeTab(int index) {
+    HibernatedTab *tab = qobject_cast<HibernatedTab*>(tabWidget->widget(index));
+    if (!tab)
+        return;
+
+    // Restored sessions bring back viewer tabs as placeholders too
+    LargeFileViewer *viewer = nullptr;
+    if (tab->reloadsFromDisk() && QFileInfo(tab->filePath).size() >= largeFileThreshold()) {
+        viewer = createViewer(tab->filePath);
+        if (!viewer)
+            return;
+    }
+    CodeEditor *editor = viewer ? nullptr : createEditor();
+    QWidget *widget = viewer ? static_cast<QWidget*>(viewer) : editor;
+
+    QString title = viewer ? QFileInfo(tab->filePath).fileName() + " (read-only)" : tabWidget->tabText(index);
+    bool current = tabWidget->currentIndex() == index;
+    wakingTab = true;
+    tabWidget->removeTab(index);
+    tabWidget->insertTab(index, widget, title);
+    if (current) {
+        tabWidget->setCurrentIndex(index);
+        activeTab = widget;
+    }
+    wakingTab = false;
+
+    if (viewer) {
+        if (tab->viewState.size() == 3) {
+            viewer->goToLine(tab->viewState.at(2).toLongLong() + viewer->verticalScrollBar()->pageStep() / 2);
+        }
+    } else if (tab->reloadsFromDisk()) {
+        editor->setProperty("pendingViewState", tab->viewState);
+        // The session stored the format, so it needn't be detected again
+        startLoading(editor, tab->filePath, tab->textFormat);
+    } else {
+        // Restoring is not an undoable edit
+        editor->document()->setUndoRedoEnabled(false);
+        SyntaxHighlighter *highlighter = attachHighlighter(editor, tab->filePath, tab->text.size());
+        if (highlighter)
+            highlighter->setLoading(true);
+        editor->appendText(QString::fromUtf8(tab->text));
+        if (highlighter)
+            highlighter->setLoading(false);
+        editor->document()->setUndoRedoEnabled(true);
+        editor->document()->setModified(tab->modified);
+        editor->setProperty("filePath", tab->filePath);
+        editor->setProperty("textFormat", tab->textFormat);
+        restoreViewState(editor, tab->viewState);
+    }
+    if (EditJournal *journal = journalOf(tab)) {
+        journal->setParent(widget);
+    }
+    tab->deleteLater();
+}
+
+void MainWindow::saveSession() {
+    QVariantList tabs;
+    int current = -1;
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        QWidget *tab = tabWidget->widget(i);
+        // Untitled documents aren't part of a session
+        QString fileName = tab->property("filePath").toString();
+        if (fileName.isEmpty())
+            continue;
+
+        QVariantList state;
+        QVariant format;
+        if (CodeEditor *editor = qobject_cast<CodeEditor*>(tab)) {
+            state = viewState(editor);
+            format = editor->property("textFormat");
+        } else if (HibernatedTab *hibernated = qobject_cast<HibernatedTab*>(tab)) {
+            state = hibernated->viewState;
+            format = hibernated->textFormat;
+        } else if (LargeFileViewer *viewer = qobject_cast<LargeFileViewer*>(tab)) {
+            state = {0, 0, viewer->verticalScrollBar()->value()};
+        }
+        const TextFormat textFormat = format.value<TextFormat>();
+
+        if (i == tabWidget->currentIndex())
+            current = tabs.size();
+        tabs.append(QVariantMap{{"path", fileName},
+                                {"viewState", state},
+                                {"encoding", int(textFormat.encoding)},
+                                {"byteOrderMark", textFormat.byteOrderMark},
+                                {"crlf", textFormat.crlf}});
+    }
+
+    QSettings settings;
+    settings.setValue("session/tabs", tabs);
+    settings.setValue("session/current", current);
+}
+
+void MainWindow::restoreSession() {
+    // Set session/restore to false to start with no tabs every time
+    QSettings settings;
+    if (!settings.value("session/restore", true).toBool())
+        return;
+    const QVariantList tabs = settings.value("session/tabs").toList();
+    const int current = settings.value("session/current", -1).toInt();
+
+    // Placeholders cost a stat each; adding them must not wake them one by one
+    QWidget *currentTab = nullptr;
+    wakingTab = true;
+    for (int i = 0; i < tabs.size(); ++i) {
+        const QVariantMap entry = tabs.at(i).toMap();
+        const QString fileName = entry.value("path").toString();
+        bool open = false;
+        for (int j = 0; j < tabWidget->count() && !open; ++j) {
+            open = tabWidget->widget(j)->property("filePath").toString() == fileName;
+        }
+        if (fileName.isEmpty() || open || !QFileInfo::exists(fileName))
+            continue;
+
+        TextFormat format;
+        format.encoding = static_cast<QStringConverter::Encoding>(entry.value("encoding", int(format.encoding)).toInt());
+        format.byteOrderMark = entry.value("byteOrderMark").toBool();
+        format.crlf = entry.value("crlf").toBool();
+
+        HibernatedTab *tab = new HibernatedTab(this);
+        tab->filePath = fileName;
+        tab->viewState = entry.value("viewState").toList();
+        tab->textFormat = QVariant::fromValue(format);
+        tab->setProperty("filePath", fileName);
+        tabWidget->addTab(tab, QFileInfo(fileName).fileName());
+        if (i == current)
+            currentTab = tab;
+    }
+    if (currentTab)
+        tabWidget->setCurrentWidget(currentTab);
+    wakingTab = false;
+
+    // Only the tab that is shown is read now
+    tabChanged(tabWidget->currentIndex());
+}
+
+QVariantList MainWindow::viewState(CodeEditor *editor) {
+    QTextCursor cursor = editor->textCursor();
+    return {cursor.anchor(), cursor.position(), editor->verticalScrollBar()->value()};
+}
+
+void MainWindow::restoreViewState(CodeEditor *editor, const QVariantList &state) {
+    if (state.size() != 3)
+        return;
+
+    // The file may have changed on disk since the state was taken
+    const int end = editor->document()->characterCount() - 1;
+    QTextCursor cursor(editor->document());
+    cursor.setPosition(qBound(0, state.at(0).toInt(), end));
+    cursor.setPosition(qBound(0, state.at(1).toInt(), end), QTextCursor::KeepAnchor);
+    editor->setTextCursor(cursor);
+    editor->verticalScrollBar()->setValue(state.at(2).toInt());
+}
+
+bool MainWindow::promptSave(CodeEditor *editor) {
+    if (!editor->document()->isModified())
+        return true;
+
+    QString fileName = editor->property("filePath").toString();
+    QString displayName = fileName.isEmpty() ? "Untitled" : QFileInfo(fileName).fileName();
+    QMessageBox::StandardButton reply;
+    reply = QMessageBox::question(this, "Save Changes",
+                                  QString("Do you want to save changes to '%1'?").arg(displayName),
+                                  QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+    if (reply == QMessageBox::Yes) {
+        if (fileName.isEmpty()) {
+            QString newFileName = QFileDialog::getSaveFileName(this, "Save File As", "",
+                                                                "Text Files (*.txt *.cpp *.h *.py *.md);;All Files (*)");
+            if (newFileName.isEmpty()) {
+                return false; // User canceled save as
+            }
+            return saveToFile(editor, newFileName, true);
+        } else {
+            return saveToFile(editor, fileName, true);
+        }
+    } else if (reply == QMessageBox::No) {
+        return true;
+    } else { // Cancel
+        return false;
+    }
+}
+
+void MainWindow::closeTab(int index) {
+    // Unsaved changes in a hibernated tab need the editor back for the save prompt
+    HibernatedTab *hibernated = qobject_cast<HibernatedTab*>(tabWidget->widget(index));
+    if (hibernated && hibernated->modified) {
+        wakeTab(index);
+    }
+
+    QWidget *widget = tabWidget->widget(index);
+    CodeEditor *editor = qobject_cast<CodeEditor*>(widget);
+    if (editor) {
+        if (!promptSave(editor)) {
+            return; // User canceled the close
+        }
+        // Stop loading and idle highlighting before the editor is torn down
+        if (FileLoadJob *job = loadJobs.take(editor)) {
+            job->cancel();
+        }
+        reloadJobs.remove(editor);
+        if (SyntaxHighlighter *highlighter = editor->document()->findChild<SyntaxHighlighter*>()) {
+            highlighter->cancelLazyHighlighting();
+        }
+        tabWidget->removeTab(index);
+        editor->deleteLater();
+    } else if (qobject_cast<LargeFileViewer*>(widget) || qobject_cast<HibernatedTab*>(widget)) {
+        tabWidget->removeTab(index);
+        widget->deleteLater();
+    } else {
+        return;
+    }
+    // Saved or deliberately thrown away by now
+    discardJournal(widget);
+    QString fileName = widget->property("filePath").toString();
+    if (!fileName.isEmpty()) {
+        unwatchFile(fileName);
+    }
+}
+
+bool MainWindow::event(QEvent *event) {
+    // Handle QFileOpenEvent when the application is triggered from Finder
+    if (event->type() == QEvent::FileOpen) {
+        QFileOpenEvent *openEvent = static_cast<QFileOpenEvent *>(event);
+        QString filePath = openEvent->file();
+        if (!filePath.isEmpty()) { // Corrected from isValid() to isEmpty()
+            openFileFromEvent(filePath);
+            return true;
+        }
+    }
+    return QMainWindow::event(event);
+}
+
+void MainWindow::closeEvent(QCloseEvent *event) {
+    // Iterate through all tabs and prompt to save if necessary
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        HibernatedTab *hibernated = qobject_cast<HibernatedTab*>(tabWidget->widget(i));
+        if (hibernated && hibernated->modified) {
+            wakeTab(i);
+        }
+        CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(i));
+        if (editor) {
+            tabWidget->setCurrentIndex(i);
+            if (!promptSave(editor)) {
+                event->ignore();
+                return; // User canceled the close
+            }
+        }
+    }
+    saveSession();
+    for (int i = 0; i < tabWidget->count(); ++i) {
+        discardJournal(tabWidget->widget(i));
+    }
+    event->accept();
+}
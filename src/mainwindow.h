@@ -0,0 +1,193 @@
+#ifndef MAINWINDOW_H
+#define MAINWINDOW_H
+
+#include "codeeditor.h"
+#include "search.h"
+
+#include <QAtomicInt>
+#include <QCloseEvent>
+#include <QDockWidget>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QListWidget>
+#include <QLockFile>
+#include <QMainWindow>
+#include <QPointer>
+#include <QSet>
+#include <QTabWidget>
+#include <QTimer>
+#include <QWidget>
+
+#include <memory>
+
+#if defined(Q_OS_MACOS)
+#include <dispatch/dispatch.h>
+#endif
+
+class ChunkSearchJob;
+class EditJournal;
+class FileLoadJob;
+class FindReplaceDialog;
+struct FolderSearch;
+class LargeFileViewer;
+class PerformancePanel;
+class ReloadJob;
+class SaveJob;
+class SyntaxHighlighter;
+
+// Main Editor Window with menu-based actions and QFileOpenEvent handling
+class MainWindow : public QMainWindow {
+    Q_OBJECT
+
+public:
+    MainWindow(QWidget *parent = nullptr);
+    ~MainWindow();
+    void openFileFromEvent(const QString &fileName);
+    void newDocument();
+    // Shows an empty document unless files were already opened; a file opened while it
+    // is still untouched replaces it
+    void openStartupDocument();
+    // Offers to bring back unsaved edits journaled by instances that crashed
+    void recoverJournals();
+    // Reopens the tabs of the last session as placeholders; a tab is only read once it is shown
+    void restoreSession();
+    // Where crash journals are kept; the benchmark suite points this at its temporary directory
+    void setJournalRoot(const QString &directory) { journalRoot = directory; }
+
+protected:
+    bool event(QEvent *event) override;
+    void closeEvent(QCloseEvent *event) override;
+
+private slots:
+    void openFile();
+    void saveFile();
+    void saveFileAs();
+    void showFindReplaceDialog();
+    void findText(const QString &text);
+    void findPreviousText(const QString &text);
+    void replaceText(const QString &text, const QString &replacement);
+    void replaceAllText(const QString &text, const QString &replacement);
+    void findInAllTabs(const QString &text);
+    void findInFolder(const QString &text);
+    void drainFolderSearch();
+    void openSearchResult(QListWidgetItem *item);
+    void tabChanged(int index);
+    void hibernateIdleTabs();
+    void showPerformancePanel();
+    void fileChanged(const QString &fileName);
+    void processChangedFiles();
+    void compactJournals();
+    void checkMemory();
+    void closeTab(int index);
+private:
+    QTabWidget *tabWidget;
+    FindReplaceDialog *findReplaceDialog = nullptr; // Built on first use
+    FindReplaceDialog *findDialog();
+    SearchQuery lastQuery;                          // Recompiled only when the text or options change
+    const SearchQuery *compiledQuery(const QString &text);
+    SearchIndex *indexFor(CodeEditor *editor, const SearchQuery &query);
+    QPointer<CodeEditor> startupDocument;           // Empty document shown at launch
+    QDockWidget *performanceDock = nullptr;         // Built on first use
+    PerformancePanel *performancePanel = nullptr;
+    void replaceStartupDocument();
+    QHash<CodeEditor*, FileLoadJob*> loadJobs; // Tabs whose file is still streaming in
+    QHash<CodeEditor*, SaveJob*> saveJobs;     // At most one save in flight per tab
+    QHash<CodeEditor*, QString> pendingSaves;  // Saves requested while one was in flight
+
+    // Find in all tabs
+    QDockWidget *searchResultsDock = nullptr;
+    QListWidget *searchResultsList = nullptr;
+    std::shared_ptr<QAtomicInt> allTabsSearchCancel;
+    int allTabsPendingJobs = 0;
+    int allTabsMatchCount = 0;
+    void addAllTabsResults(const ChunkSearchJob *job);
+    void updateSearchResultsTitle();
+    void showSearchResults();
+    void cancelSearches();
+
+    // Find in folder
+    std::shared_ptr<FolderSearch> folderSearch;
+    QTimer folderSearchTimer;
+    static QStringList folderIgnorePatterns();
+    void goToLine(QWidget *tab, qint64 line);
+
+    CodeEditor* currentEditor();
+    CodeEditor *createEditor();
+    // knownFormat, a TextFormat, skips detecting the encoding and line endings
+    void startLoading(CodeEditor *editor, const QString &fileName, const QVariant &knownFormat = QVariant());
+
+    // Files changed on disk: growth is appended, anything else reloads the changed span
+    QFileSystemWatcher fileWatcher;
+    QSet<QString> changedFiles;
+    QTimer fileChangeTimer;             // Coalesces bursts of writes to a log
+    void watchFile(const QString &fileName);
+    void unwatchFile(const QString &fileName);
+    QHash<CodeEditor*, ReloadJob*> reloadJobs;
+    static QByteArray diskTail(const QString &fileName, qint64 size);
+    void recordDiskState(QWidget *tab, const QString &fileName, qint64 size);
+    void appendFromDisk(CodeEditor *editor, const QString &fileName, qint64 offset);
+    void reloadFromDisk(CodeEditor *editor, const QString &fileName);
+
+    // Crash journal of unsaved edits, one per modified tab
+    QString journalRoot;
+    QString journalDirectory;               // This instance's, locked while it runs
+    std::unique_ptr<QLockFile> journalLock;
+    int journalCount = 0;
+    QTimer journalCompactTimer;
+    bool journalPaused = false;             // Set while the text changes without being edited
+    bool ensureJournalDirectory();
+    void trackEdits(CodeEditor *editor);
+    void journalEdit(CodeEditor *editor, qint64 position, qint64 removed, const QString &text);
+    EditJournal *startJournal(CodeEditor *editor);
+    static EditJournal *journalOf(QWidget *tab);
+    void discardJournal(QWidget *tab);
+    void rebaseJournal(CodeEditor *editor);
+    void compactJournal(CodeEditor *editor);
+    void replayJournal(CodeEditor *editor, const QString &journalPath);
+
+    // Tab hibernation
+    QTimer hibernateTimer;
+    QElapsedTimer uptime;               // Clock for the lastActive tab property
+    QPointer<QWidget> activeTab;
+    bool wakingTab = false;
+    static int hibernateAfterMinutes();
+    void hibernateTab(int index);
+    void wakeTab(int index);
+    static QVariantList viewState(CodeEditor *editor);
+    static void restoreViewState(CodeEditor *editor, const QVariantList &state);
+
+    // Session
+    void saveSession();
+
+    // Memory accounting: reported in the performance panel, and given back under pressure
+    // from macOS or when the estimate passes memory/limitMB
+    QTimer memoryTimer;
+    static qint64 memoryLimit();
+    qint64 accountedMemory();
+    QString memoryReport();
+    void relieveMemoryPressure(bool critical);
+#if defined(Q_OS_MACOS)
+    dispatch_source_t memoryPressureSource = nullptr;
+    static void memoryPressureEvent(void *context);
+#endif
+
+    static qint64 largeFileThreshold();
+    static qint64 highlightSizeLimit();
+    // Gives editor the highlighter for fileName's language, replacing one for another language.
+    // Returns null, and leaves the document unhighlighted, for plain text and huge files.
+    SyntaxHighlighter *attachHighlighter(CodeEditor *editor, const QString &fileName, qint64 size);
+    static bool pieceTableEnabled();
+    static bool minimapEnabled();
+    LargeFileViewer *createViewer(const QString &fileName);
+    void openInViewer(const QString &fileName);
+    // Saves in the background unless wait is set, which closing a tab or the window needs
+    bool saveToFile(CodeEditor *editor, const QString &fileName, bool wait = false);
+    void adoptFileName(CodeEditor *editor, const QString &fileName);
+    bool saveCurrentFile();
+    bool findInEditor(const QString &text, bool backward);
+    void findInViewer(LargeFileViewer *viewer, const QString &text, bool backward);
+    bool promptSave(CodeEditor *editor);
+};
+
+#endif // MAINWINDOW_H
@@ -0,0 +1,205 @@
+#include "minimap.h"
+#include "codeeditor.h"
+#include "perf.h"
+
+#include <QColor>
+#include <QObject>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextDocument>
+
+#include <climits>
+
+Minimap::Minimap(CodeEditor *editor) : QWidget(editor), editor(editor) {
+    setCursor(Qt::PointingHandCursor);
+    for (QTextBlock block = editor->document()->firstBlock(); block.isValid(); block = block.next()) {
+        shapes.append(shape(block));
+    }
+    connect(editor->document(), &QTextDocument::contentsChange, this, &Minimap::contentsChange);
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged, this, qOverload<>(&QWidget::update));
+
+    // A burst of edits renders once per frame
+    renderTimer.setSingleShot(true);
+    renderTimer.setInterval(16);
+    connect(&renderTimer, &QTimer::timeout, this, &Minimap::render);
+}
+
+void Minimap::setSearchIndex(SearchIndex *index) {
+    searchIndex = index;
+    connect(index, &SearchIndex::changed, this, &Minimap::scheduleRender);
+    connect(index, &QObject::destroyed, this, &Minimap::scheduleRender);
+    scheduleRender();
+}
+
+Minimap::LineShape Minimap::shape(const QTextBlock &block) {
+    const QString text = block.text();
+    LineShape line;
+    int indent = 0;
+    qsizetype pos = 0;
+    for (; pos < text.size(); ++pos) {
+        if (text.at(pos) == QLatin1Char(' '))
+            indent += 1;
+        else if (text.at(pos) == QLatin1Char('\t'))
+            indent += 4;
+        else
+            break;
+    }
+    line.indent = static_cast<quint8>(qMin(255, indent));
+    line.length = static_cast<quint8>(qMin<qsizetype>(255, text.size() - pos));
+    const QStringView rest = QStringView(text).mid(pos);
+    line.comment = rest.startsWith(QLatin1String("//")) || rest.startsWith(QLatin1String("/*"))
+                   || rest.startsWith(QLatin1Char('*')) || rest.startsWith(QLatin1Char('#'));
+    return line;
+}
+
+void Minimap::contentsChange(int position, int /* charsRemoved */, int charsAdded) {
+    QTextDocument *document = editor->document();
+    QTextBlock first = document->findBlock(position);
+    QTextBlock last = document->findBlock(position + charsAdded);
+    if (!first.isValid())
+        first = document->lastBlock();
+    if (!last.isValid())
+        last = document->lastBlock();
+
+    // Blocks first..last replace the old blocks first..last - delta
+    const int firstNumber = first.blockNumber();
+    const int lastNumber = last.blockNumber();
+    const int delta = document->blockCount() - static_cast<int>(shapes.size());
+    const int oldLast = qBound(firstNumber - 1, lastNumber - delta, static_cast<int>(shapes.size()) - 1);
+    if (firstNumber > shapes.size() || oldLast < firstNumber - 1) {
+        shapes.clear();
+        for (QTextBlock block = document->firstBlock(); block.isValid(); block = block.next())
+            shapes.append(shape(block));
+    } else {
+        shapes.remove(firstNumber, oldLast - firstNumber + 1);
+        shapes.insert(firstNumber, lastNumber - firstNumber + 1, LineShape());
+        int number = firstNumber;
+        for (QTextBlock block = first; block.isValid() && number <= lastNumber; block = block.next())
+            shapes[number++] = shape(block);
+    }
+    scheduleRender();
+}
+
+void Minimap::scheduleRender() {
+    if (!renderTimer.isActive())
+        renderTimer.start();
+}
+
+double Minimap::blocksPerRow() const {
+    const int rows = qMax(1, qRound(height() * devicePixelRatioF()));
+    return qMax(0.5, double(shapes.size()) / rows);
+}
+
+void Minimap::render() {
+    PerfScope perf("Minimap::render");
+
+    const qreal ratio = devicePixelRatioF();
+    const QSize pixels = size() * ratio;
+    if (pixels.isEmpty())
+        return;
+    image = QImage(pixels, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(ratio);
+    image.fill(palette().base().color());
+
+    // A column per character of the first 120 or so
+    const double columnWidth = pixels.width() / 120.0;
+    const QRgb codeColor = QColor(Qt::darkGray).rgb();
+    const QRgb commentColor = QColor(Qt::gray).lighter(130).rgb();
+    const double perRow = blocksPerRow();
+    const qsizetype count = shapes.size();
+
+    for (int y = 0; y < pixels.height(); ++y) {
+        const qsizetype from = static_cast<qsizetype>(y * perRow);
+        if (from >= count)
+            break;
+        const qsizetype to = qMin(count, qMax(from + 1, static_cast<qsizetype>((y + 1) * perRow)));
+
+        // Rows covering several blocks show their combined extent
+        int indent = 255;
+        int end = 0;
+        int comments = 0;
+        int filled = 0;
+        for (qsizetype i = from; i < to; ++i) {
+            const LineShape &line = shapes.at(i);
+            if (line.length == 0)
+                continue;
+            indent = qMin(indent, int(line.indent));
+            end = qMax(end, line.indent + line.length);
+            comments += line.comment;
+            ++filled;
+        }
+        if (filled == 0)
+            continue;
+
+        QRgb *row = reinterpret_cast<QRgb *>(image.scanLine(y));
+        const int x0 = qMin(pixels.width(), static_cast<int>(indent * columnWidth));
+        const int x1 = qMin(pixels.width(), qMax(x0 + 1, static_cast<int>(end * columnWidth)));
+        const QRgb color = comments * 2 > filled ? commentColor : codeColor;
+        for (int x = x0; x < x1; ++x)
+            row[x] = color;
+    }
+
+    // Rows holding matches, from the block positions at each row's start and the sorted matches
+    matchRows.clear();
+    if (searchIndex && searchIndex->count() > 0) {
+        const QList<int> &positions = searchIndex->matchPositions();
+        QTextDocument *document = editor->document();
+        qsizetype match = 0;
+        for (int y = 0; y < pixels.height() && match < positions.size(); ++y) {
+            const qsizetype to = qMin(count, static_cast<qsizetype>((y + 1) * perRow));
+            const QTextBlock next = document->findBlockByNumber(static_cast<int>(to));
+            const int rowEnd = next.isValid() ? next.position() : INT_MAX;
+            if (positions.at(match) < rowEnd) {
+                matchRows.append(y);
+                while (match < positions.size() && positions.at(match) < rowEnd)
+                    ++match;
+            }
+        }
+    }
+    update();
+}
+
+void Minimap::paintEvent(QPaintEvent * /* event */) {
+    QPainter painter(this);
+    if (image.isNull() || image.size() != size() * devicePixelRatioF())
+        render();
+    painter.drawImage(0, 0, image);
+
+    const qreal ratio = devicePixelRatioF();
+    const double perRow = blocksPerRow();
+
+    // The part of the document on screen
+    const int lineHeight = qMax(1, editor->fontMetrics().lineSpacing());
+    const int first = editor->firstVisibleBlock().blockNumber();
+    const int visible = editor->viewport()->height() / lineHeight;
+    const qreal top = first / perRow / ratio;
+    const qreal height = qMax<qreal>(4, visible / perRow / ratio);
+    painter.fillRect(QRectF(0, top, width(), height), QColor(0, 0, 0, 24));
+
+    QColor matchColor(255, 140, 0);
+    for (int row : std::as_const(matchRows)) {
+        painter.fillRect(QRectF(width() - 6, row / ratio, 6, qMax<qreal>(2, 1 / ratio)), matchColor);
+    }
+}
+
+void Minimap::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+    scheduleRender();
+}
+
+void Minimap::scrollTo(qreal y) {
+    // Centres the block under y, going by line numbers so folded blocks are accounted for
+    const int number = static_cast<int>(y * devicePixelRatioF() * blocksPerRow());
+    QTextBlock block = editor->document()->findBlockByNumber(qBound(0, number, editor->document()->blockCount() - 1));
+    QScrollBar *bar = editor->verticalScrollBar();
+    bar->setValue(block.firstLineNumber() - bar->pageStep() / 2);
+}
+
+void Minimap::mousePressEvent(QMouseEvent *event) {
+    scrollTo(event->position().y());
+}
+
+void Minimap::mouseMoveEvent(QMouseEvent *event) {
+    if (event->buttons() & Qt::LeftButton)
+        scrollTo(event->position().y());
+}
@@ -0,0 +1,61 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include "search.h"
+
+#include <QImage>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPointer>
+#include <QResizeEvent>
+#include <QTextBlock>
+#include <QTimer>
+#include <QWidget>
+
+class CodeEditor;
+
+// Overview of the whole document to the right of an editor.
+// The shape of every block (indent, length, comment or code) is cached and patched from
+// contentsChange, and the picture is drawn from that cache into an image at most once a
+// frame. Painting blits the image and never walks the document, however long it is.
+class Minimap : public QWidget {
+    Q_OBJECT
+
+public:
+    static constexpr int preferredWidth = 96;
+
+    Minimap(CodeEditor *editor);
+    // Matches of the find dialog's query are marked along the right edge
+    void setSearchIndex(SearchIndex *index);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private slots:
+    void contentsChange(int position, int charsRemoved, int charsAdded);
+    void scheduleRender();
+    void render();
+
+private:
+    struct LineShape {
+        quint8 indent = 0;
+        quint8 length = 0;
+        bool comment = false;
+    };
+    static LineShape shape(const QTextBlock &block);
+    // Blocks per row of device pixels; short documents get two rows per block
+    double blocksPerRow() const;
+    void scrollTo(qreal y);
+
+    CodeEditor *editor;
+    QPointer<SearchIndex> searchIndex;
+    QList<LineShape> shapes;
+    QImage image;
+    QList<int> matchRows;
+    QTimer renderTimer;
+};
+
+#endif // MINIMAP_H
@@ -0,0 +1,54 @@
+#include "perf.h"
+
+#include <QHash>
+#include <QThread>
+
+PerfRecorder &PerfRecorder::instance() {
+    static PerfRecorder recorder;
+    return recorder;
+}
+
+void PerfRecorder::add(const char *name, qint64 start, qint64 duration) {
+    QMutexLocker locker(&mutex);
+    if (buffer.size() < maxEvents)
+        buffer.append(Event{name, start, duration, QThread::currentThreadId()});
+}
+
+void PerfRecorder::clear() {
+    QMutexLocker locker(&mutex);
+    buffer.clear();
+}
+
+QList<PerfRecorder::Event> PerfRecorder::events() const {
+    QMutexLocker locker(&mutex);
+    return buffer;
+}
+
+QByteArray PerfRecorder::chromeTrace() const {
+    const QList<Event> spans = events();
+
+    // Chrome wants small thread ids; number threads in order of appearance
+    QHash<Qt::HANDLE, int> threadIds;
+    QByteArray json = "{\"traceEvents\":[";
+    for (qsizetype i = 0; i < spans.size(); ++i) {
+        const Event &span = spans.at(i);
+        int tid = threadIds.value(span.thread, -1);
+        if (tid == -1) {
+            tid = threadIds.size() + 1;
+            threadIds.insert(span.thread, tid);
+        }
+        if (i > 0)
+            json += ',';
+        json += "\n{\"name\":\"";
+        json += span.name;
+        json += "\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+        json += QByteArray::number(tid);
+        json += ",\"ts\":";
+        json += QByteArray::number(span.start / 1000.0, 'f', 3);
+        json += ",\"dur\":";
+        json += QByteArray::number(span.duration / 1000.0, 'f', 3);
+        json += '}';
+    }
+    json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return json;
+}
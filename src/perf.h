@@ -0,0 +1,63 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+
+// Performance instrumentation
+// A PerfScope times the rest of the enclosing scope. While recording is off it costs one
+// relaxed atomic load; while on, each span is appended to a shared buffer that the
+// Performance panel summarises and exports as Chrome trace JSON.
+class PerfRecorder {
+public:
+    struct Event {
+        const char *name;   // A string literal
+        qint64 start;       // Nanoseconds since the recorder was created
+        qint64 duration;
+        Qt::HANDLE thread;
+    };
+
+    // Spans beyond this many are dropped until the buffer is cleared
+    static const int maxEvents = 1000000;
+
+    static PerfRecorder &instance();
+    static bool isRecording() { return recording.loadRelaxed(); }
+
+    void setRecording(bool on) { recording.storeRelaxed(on); }
+    qint64 now() const { return clock.nsecsElapsed(); }
+    void add(const char *name, qint64 start, qint64 duration);
+    void clear();
+    QList<Event> events() const;
+    QByteArray chromeTrace() const;
+
+private:
+    PerfRecorder() { clock.start(); }
+
+    static inline QAtomicInt recording;
+    QElapsedTimer clock;
+    mutable QMutex mutex;
+    QList<Event> buffer;    // Guarded by mutex
+};
+
+class PerfScope {
+public:
+    explicit PerfScope(const char *name) : name(PerfRecorder::isRecording() ? name : nullptr) {
+        if (this->name)
+            start = PerfRecorder::instance().now();
+    }
+    ~PerfScope() {
+        if (name) {
+            PerfRecorder &recorder = PerfRecorder::instance();
+            recorder.add(name, start, recorder.now() - start);
+        }
+    }
+    PerfScope(const PerfScope &) = delete;
+    PerfScope &operator=(const PerfScope &) = delete;
+
+private:
+    const char *name;
+    qint64 start = 0;
+};
+
+#endif // PERF_H
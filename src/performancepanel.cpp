@@ -0,0 +1,153 @@
+#include "performancepanel.h"
+#include "perf.h"
+
+#include <QFileDialog>
+#include <QFontDatabase>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMap>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSaveFile>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+static QString formatDuration(qint64 ns) {
+    if (ns < 1000)
+        return QString("%1 ns").arg(ns);
+    if (ns < 1000 * 1000)
+        return QString("%1 us").arg(ns / 1000.0, 0, 'f', 1);
+    return QString("%1 ms").arg(ns / 1000000.0, 0, 'f', 2);
+}
+
+static QString perfReport(const QList<PerfRecorder::Event> &events) {
+    // Bucket i holds spans of [2^(i-1), 2^i) microseconds; the last one everything longer
+    const int bucketCount = 20;
+    const int barWidth = 40;
+
+    QMap<QByteArray, QList<qint64>> durations;
+    for (const PerfRecorder::Event &event : events) {
+        durations[QByteArray(event.name)].append(event.duration);
+    }
+
+    QString report;
+    for (auto it = durations.begin(); it != durations.end(); ++it) {
+        QList<qint64> &spans = it.value();
+        std::sort(spans.begin(), spans.end());
+        qint64 total = 0;
+        int buckets[bucketCount] = {};
+        for (qint64 ns : std::as_const(spans)) {
+            total += ns;
+            qint64 us = ns / 1000;
+            int bucket = us == 0 ? 0 : qMin(bucketCount - 1, 64 - qCountLeadingZeroBits(quint64(us)));
+            ++buckets[bucket];
+        }
+
+        report += QString("%1\n  %2 calls, total %3, mean %4, p50 %5, p99 %6, max %7\n")
+                  .arg(QString::fromLatin1(it.key())).arg(spans.size())
+                  .arg(formatDuration(total), formatDuration(total / spans.size()),
+                       formatDuration(spans.at(spans.size() / 2)),
+                       formatDuration(spans.at(qMin(spans.size() - 1, spans.size() * 99 / 100))),
+                       formatDuration(spans.last()));
+
+        int first = 0;
+        int last = bucketCount - 1;
+        while (!buckets[first])
+            ++first;
+        while (!buckets[last])
+            --last;
+        const int peak = *std::max_element(buckets, buckets + bucketCount);
+        for (int bucket = first; bucket <= last; ++bucket) {
+            QString label = bucket == 0 ? QString("< 1 us")
+                          : bucket == bucketCount - 1 ? QString(">= %1 us").arg(qint64(1) << (bucket - 1))
+                          : QString("< %1 us").arg(qint64(1) << bucket);
+            report += QString("  %1 |%2 %3\n").arg(label, 12)
+                      .arg(QString(buckets[bucket] * barWidth / peak, QLatin1Char('#')))
+                      .arg(buckets[bucket]);
+        }
+        report += '\n';
+    }
+    return report.isEmpty() ? QString("Nothing recorded yet.") : report;
+}
+
+PerformancePanel::PerformancePanel(QWidget *parent) : QWidget(parent) {
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    recordBox = new QCheckBox("Record", this);
+    recordBox->setChecked(PerfRecorder::isRecording());
+    QPushButton *clearButton = new QPushButton("Clear", this);
+    QPushButton *exportButton = new QPushButton("Export Trace...", this);
+    buttonLayout->addWidget(recordBox);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(clearButton);
+    buttonLayout->addWidget(exportButton);
+    mainLayout->addLayout(buttonLayout);
+
+    reportView = new QPlainTextEdit(this);
+    reportView->setReadOnly(true);
+    reportView->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    mainLayout->addWidget(reportView);
+
+    QHBoxLayout *memoryLayout = new QHBoxLayout();
+    QPushButton *trimButton = new QPushButton("Free Memory", this);
+    trimButton->setToolTip("Drop background tabs' search indices and undo history");
+    memoryLayout->addWidget(new QLabel("Memory (estimated)", this));
+    memoryLayout->addStretch();
+    memoryLayout->addWidget(trimButton);
+    mainLayout->addLayout(memoryLayout);
+
+    memoryView = new QPlainTextEdit(this);
+    memoryView->setReadOnly(true);
+    memoryView->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    mainLayout->addWidget(memoryView);
+
+    connect(recordBox, &QCheckBox::toggled, this, &PerformancePanel::setRecording);
+    connect(clearButton, &QPushButton::clicked, this, &PerformancePanel::clear);
+    connect(exportButton, &QPushButton::clicked, this, &PerformancePanel::exportTrace);
+    connect(trimButton, &QPushButton::clicked, this, &PerformancePanel::trimMemoryRequested);
+
+    // The report is rebuilt once a second while recording
+    refreshTimer.setInterval(1000);
+    connect(&refreshTimer, &QTimer::timeout, this, &PerformancePanel::refresh);
+    if (PerfRecorder::isRecording())
+        refreshTimer.start();
+    refresh();
+}
+
+void PerformancePanel::setRecording(bool on) {
+    PerfRecorder::instance().setRecording(on);
+    if (on) {
+        refreshTimer.start();
+    } else {
+        refreshTimer.stop();
+        refresh();
+    }
+}
+
+void PerformancePanel::refresh() {
+    if (isVisible())
+        reportView->setPlainText(perfReport(PerfRecorder::instance().events()));
+}
+
+void PerformancePanel::setMemoryReport(const QString &report) {
+    memoryView->setPlainText(report);
+}
+
+void PerformancePanel::clear() {
+    PerfRecorder::instance().clear();
+    refresh();
+}
+
+void PerformancePanel::exportTrace() {
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Trace", "mactext-trace.json",
+                                                    "Chrome Trace (*.json);;All Files (*)");
+    if (fileName.isEmpty())
+        return;
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(PerfRecorder::instance().chromeTrace()) < 0 || !file.commit()) {
+        QMessageBox::warning(this, "Error", QString("Could not export trace: %1").arg(file.errorString()));
+    }
+}
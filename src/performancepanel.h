@@ -0,0 +1,36 @@
+#ifndef PERFORMANCEPANEL_H
+#define PERFORMANCEPANEL_H
+
+#include <QCheckBox>
+#include <QPlainTextEdit>
+#include <QTimer>
+#include <QWidget>
+
+// Performance panel
+// Summarises the recorded spans per scope with a log2 histogram of their durations.
+class PerformancePanel : public QWidget {
+    Q_OBJECT
+
+public:
+    PerformancePanel(QWidget *parent = nullptr);
+
+public slots:
+    void setMemoryReport(const QString &report);
+
+signals:
+    void trimMemoryRequested();
+
+private slots:
+    void setRecording(bool on);
+    void refresh();
+    void clear();
+    void exportTrace();
+
+private:
+    QCheckBox *recordBox;
+    QPlainTextEdit *reportView;
+    QPlainTextEdit *memoryView;
+    QTimer refreshTimer;
+};
+
+#endif // PERFORMANCEPANEL_H
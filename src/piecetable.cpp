@@ -0,0 +1,130 @@
+#include "piecetable.h"
+
+#include <QRandomGenerator>
+
+#include <algorithm>
+
+PieceTable::NodePtr PieceTable::makeLeaf(TextPtr text, qint64 length) {
+    return std::make_shared<const Node>(Node{std::move(text), length, QRandomGenerator::global()->generate(),
+                                             nullptr, nullptr, length});
+}
+
+PieceTable::NodePtr PieceTable::withChildren(const Node *node, NodePtr left, NodePtr right) {
+    qint64 total = node->length + (left ? left->totalLength : 0) + (right ? right->totalLength : 0);
+    return std::make_shared<const Node>(Node{node->text, node->length, node->priority,
+                                             std::move(left), std::move(right), total});
+}
+
+std::pair<PieceTable::NodePtr, PieceTable::NodePtr> PieceTable::split(const NodePtr &node, qint64 position) {
+    if (!node)
+        return {};
+
+    qint64 leftLength = node->left ? node->left->totalLength : 0;
+    if (position <= leftLength) {
+        auto [left, right] = split(node->left, position);
+        return {left, withChildren(node.get(), right, node->right)};
+    }
+    if (position >= leftLength + node->length) {
+        auto [left, right] = split(node->right, position - leftLength - node->length);
+        return {withChildren(node.get(), node->left, left), right};
+    }
+
+    // The split point falls inside this piece
+    qint64 offset = position - leftLength;
+    NodePtr head = makeLeaf(node->text, offset);
+    NodePtr tail = makeLeaf(TextPtr(node->text, node->text.get() + offset), node->length - offset);
+    return {merge(node->left, head), merge(tail, node->right)};
+}
+
+PieceTable::NodePtr PieceTable::merge(const NodePtr &left, const NodePtr &right) {
+    if (!left)
+        return right;
+    if (!right)
+        return left;
+    if (left->priority > right->priority)
+        return withChildren(left.get(), left->left, merge(left->right, right));
+    return withChildren(right.get(), merge(left, right->left), right->right);
+}
+
+void PieceTable::insert(qint64 position, QStringView text) {
+    // Size of a fresh add chunk; larger insertions get a chunk of their own
+    const qint64 addChunkSize = 64 * 1024;
+
+    if (text.isEmpty())
+        return;
+    position = qBound<qint64>(0, position, length());
+    auto [left, right] = split(root, position);
+
+    // Typing right after the previous insertion extends its piece instead of adding one
+    if (left && text.size() <= addCapacity - addUsed) {
+        const Node *last = left.get();
+        while (last->right)
+            last = last->right.get();
+        if (last->text.get() + last->length == addChunk.get() + addUsed) {
+            std::copy(text.utf16(), text.utf16() + text.size(), addChunk.get() + addUsed);
+            addUsed += text.size();
+            NodePtr head = split(left, left->totalLength - last->length).first;
+            root = merge(merge(head, makeLeaf(last->text, last->length + text.size())), right);
+            return;
+        }
+    }
+
+    if (text.size() > addCapacity - addUsed) {
+        addCapacity = qMax<qint64>(addChunkSize, text.size());
+        addChunk.reset(new char16_t[addCapacity]);
+        addUsed = 0;
+    }
+    char16_t *start = addChunk.get() + addUsed;
+    std::copy(text.utf16(), text.utf16() + text.size(), start);
+    addUsed += text.size();
+
+    root = merge(merge(left, makeLeaf(TextPtr(addChunk, start), text.size())), right);
+}
+
+void PieceTable::remove(qint64 position, qint64 count) {
+    position = qBound<qint64>(0, position, length());
+    count = qBound<qint64>(0, count, length() - position);
+    if (count == 0)
+        return;
+
+    auto [left, rest] = split(root, position);
+    root = merge(left, split(rest, count).second);
+}
+
+void PieceTable::appendOriginal(const QString &text) {
+    if (text.isEmpty())
+        return;
+
+    auto buffer = std::make_shared<const QString>(text);
+    TextPtr start(buffer, reinterpret_cast<const char16_t *>(buffer->constData()));
+    root = merge(root, makeLeaf(start, text.size()));
+}
+
+QString PieceTable::Snapshot::mid(qint64 position, qint64 count) const {
+    position = qBound<qint64>(0, position, length());
+    count = qBound<qint64>(0, count, length() - position);
+
+    QString out;
+    out.reserve(count);
+    collect(root.get(), position, position + count, out);
+    return out;
+}
+
+void PieceTable::Snapshot::collect(const Node *node, qint64 from, qint64 to, QString &out) {
+    // from and to are relative to the start of node's subtree
+    if (!node || from >= to)
+        return;
+
+    qint64 pieceStart = node->left ? node->left->totalLength : 0;
+    qint64 pieceEnd = pieceStart + node->length;
+    if (from < pieceStart)
+        collect(node->left.get(), from, qMin(to, pieceStart), out);
+
+    qint64 begin = qMax(from, pieceStart);
+    qint64 end = qMin(to, pieceEnd);
+    if (begin < end)
+        out.append(QStringView(node->text.get() + (begin - pieceStart), end - begin));
+
+    if (to > pieceEnd)
+        collect(node->right.get(), qMax<qint64>(0, from - pieceEnd), to - pieceEnd, out);
+}
@@ -0,0 +1,80 @@
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <QString>
+
+#include <memory>
+
+// Piece table
+// Text is held in immutable pieces that point into the original buffers or into append-only
+// add chunks. The pieces live in a persistent treap ordered by position, so inserts and
+// removals are O(log n), and a snapshot is a single shared pointer that stays valid, and
+// safe to read from any thread, however the table is edited afterwards.
+class PieceTable {
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+    using TextPtr = std::shared_ptr<const char16_t>;
+
+    struct Node {
+        TextPtr text;
+        qint64 length;
+        quint32 priority;
+        NodePtr left;
+        NodePtr right;
+        qint64 totalLength;
+    };
+
+public:
+    class Snapshot {
+    public:
+        Snapshot() = default;
+
+        qint64 length() const { return root ? root->totalLength : 0; }
+        QString text() const { return mid(0, length()); }
+        QString mid(qint64 position, qint64 length) const;
+
+        // Calls function(QStringView) for each piece in document order
+        template <typename Function>
+        void forEachPiece(Function function) const { visit(root.get(), function); }
+
+    private:
+        friend class PieceTable;
+        explicit Snapshot(NodePtr root) : root(std::move(root)) {}
+
+        template <typename Function>
+        static void visit(const Node *node, Function &function) {
+            while (node) {
+                visit(node->left.get(), function);
+                function(QStringView(node->text.get(), node->length));
+                node = node->right.get();
+            }
+        }
+        static void collect(const Node *node, qint64 from, qint64 to, QString &out);
+
+        NodePtr root;
+    };
+
+    PieceTable() = default;
+    explicit PieceTable(const QString &original) { appendOriginal(original); }
+
+    qint64 length() const { return root ? root->totalLength : 0; }
+    Snapshot snapshot() const { return Snapshot(root); }
+
+    void insert(qint64 position, QStringView text);
+    void remove(qint64 position, qint64 length);
+    // Appends text as a new original buffer; the string is shared, not copied
+    void appendOriginal(const QString &text);
+
+private:
+    static NodePtr makeLeaf(TextPtr text, qint64 length);
+    static NodePtr withChildren(const Node *node, NodePtr left, NodePtr right);
+    static std::pair<NodePtr, NodePtr> split(const NodePtr &node, qint64 position);
+    static NodePtr merge(const NodePtr &left, const NodePtr &right);
+
+    NodePtr root;
+    std::shared_ptr<char16_t[]> addChunk;
+    qint64 addUsed = 0;
+    qint64 addCapacity = 0;
+};
+
+#endif // PIECETABLE_H
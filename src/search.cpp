@@ -0,0 +1,490 @@
+#include "search.h"
+
+#include <QStringEncoder>
+#include <QTextBlock>
+#include <QTextCursor>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Literal search kernel
+// Tests the needle's first and last characters against a whole vector of haystack positions
+// at once and only verifies candidates that pass both. The widest kernel the CPU supports
+// is picked on first use: NEON on Apple Silicon, AVX2 or SSE2 on Intel.
+template <typename Char>
+static inline bool literalMatchesAt(const Char *at, const BasicLiteralPattern<Char> &p) {
+    if (!p.caseInsensitive)
+        return memcmp(at, p.text, size_t(p.length) * sizeof(Char)) == 0;
+
+    for (qsizetype i = 0; i < p.length; ++i) {
+        Char c = at[i];
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        if (c != p.text[i])
+            return false;
+    }
+    return true;
+}
+
+template <typename Char>
+static qsizetype findLiteralScalar(const Char *haystack, qsizetype length, const BasicLiteralPattern<Char> &p, qsizetype from) {
+    const qsizetype lastStart = length - p.length;
+    for (qsizetype i = from; i <= lastStart; ++i) {
+        Char f = haystack[i];
+        Char l = haystack[i + p.length - 1];
+        if ((f == p.first[0] || f == p.first[1]) && (l == p.last[0] || l == p.last[1])
+                && literalMatchesAt(haystack + i, p))
+            return i;
+    }
+    return -1;
+}
+
+#if defined(__SSE2__)
+static qsizetype findLiteralSse2(const char16_t *haystack, qsizetype length, const LiteralPattern &p, qsizetype from) {
+    const qsizetype lastStart = length - p.length;
+    const __m128i first0 = _mm_set1_epi16(short(p.first[0]));
+    const __m128i first1 = _mm_set1_epi16(short(p.first[1]));
+    const __m128i last0 = _mm_set1_epi16(short(p.last[0]));
+    const __m128i last1 = _mm_set1_epi16(short(p.last[1]));
+
+    qsizetype i = from;
+    for (; i + 8 <= lastStart + 1; i += 8) {
+        __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + p.length - 1));
+        __m128i eq = _mm_and_si128(_mm_or_si128(_mm_cmpeq_epi16(f, first0), _mm_cmpeq_epi16(f, first1)),
+                                   _mm_or_si128(_mm_cmpeq_epi16(l, last0), _mm_cmpeq_epi16(l, last1)));
+        // Two mask bits per 16-bit lane; keep one
+        quint32 mask = quint32(_mm_movemask_epi8(eq)) & 0x5555u;
+        while (mask) {
+            int lane = qCountTrailingZeroBits(mask) / 2;
+            if (literalMatchesAt(haystack + i + lane, p))
+                return i + lane;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralScalar(haystack, length, p, i);
+}
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MACTEXT_HAVE_AVX2_KERNEL
+__attribute__((target("avx2")))
+static qsizetype findLiteralAvx2(const char16_t *haystack, qsizetype length, const LiteralPattern &p, qsizetype from) {
+    const qsizetype lastStart = length - p.length;
+    const __m256i first0 = _mm256_set1_epi16(short(p.first[0]));
+    const __m256i first1 = _mm256_set1_epi16(short(p.first[1]));
+    const __m256i last0 = _mm256_set1_epi16(short(p.last[0]));
+    const __m256i last1 = _mm256_set1_epi16(short(p.last[1]));
+
+    qsizetype i = from;
+    for (; i + 16 <= lastStart + 1; i += 16) {
+        __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i + p.length - 1));
+        __m256i eq = _mm256_and_si256(_mm256_or_si256(_mm256_cmpeq_epi16(f, first0), _mm256_cmpeq_epi16(f, first1)),
+                                      _mm256_or_si256(_mm256_cmpeq_epi16(l, last0), _mm256_cmpeq_epi16(l, last1)));
+        quint32 mask = quint32(_mm256_movemask_epi8(eq)) & 0x55555555u;
+        while (mask) {
+            int lane = qCountTrailingZeroBits(mask) / 2;
+            if (literalMatchesAt(haystack + i + lane, p))
+                return i + lane;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralScalar(haystack, length, p, i);
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+static qsizetype findLiteralNeon(const char16_t *haystack, qsizetype length, const LiteralPattern &p, qsizetype from) {
+    const qsizetype lastStart = length - p.length;
+    const uint16x8_t first0 = vdupq_n_u16(p.first[0]);
+    const uint16x8_t first1 = vdupq_n_u16(p.first[1]);
+    const uint16x8_t last0 = vdupq_n_u16(p.last[0]);
+    const uint16x8_t last1 = vdupq_n_u16(p.last[1]);
+
+    qsizetype i = from;
+    for (; i + 8 <= lastStart + 1; i += 8) {
+        uint16x8_t f = vld1q_u16(reinterpret_cast<const uint16_t *>(haystack + i));
+        uint16x8_t l = vld1q_u16(reinterpret_cast<const uint16_t *>(haystack + i + p.length - 1));
+        uint16x8_t eq = vandq_u16(vorrq_u16(vceqq_u16(f, first0), vceqq_u16(f, first1)),
+                                  vorrq_u16(vceqq_u16(l, last0), vceqq_u16(l, last1)));
+        // Narrow to one byte per lane so the whole comparison fits in a 64-bit mask
+        quint64 mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(eq)), 0);
+        while (mask) {
+            int lane = qCountTrailingZeroBits(mask) / 8;
+            if (literalMatchesAt(haystack + i + lane, p))
+                return i + lane;
+            mask &= ~(quint64(0xff) << (lane * 8));
+        }
+    }
+    return findLiteralScalar(haystack, length, p, i);
+}
+#endif
+
+using LiteralKernel = qsizetype (*)(const char16_t *, qsizetype, const LiteralPattern &, qsizetype);
+
+static LiteralKernel literalKernel() {
+    static const LiteralKernel kernel = []() -> LiteralKernel {
+#if defined(__ARM_NEON) || defined(__aarch64__)
+        return findLiteralNeon;
+#else
+#  if defined(MACTEXT_HAVE_AVX2_KERNEL)
+        if (__builtin_cpu_supports("avx2"))
+            return findLiteralAvx2;
+#  endif
+#  if defined(__SSE2__)
+        return findLiteralSse2;
+#  else
+        return findLiteralScalar<char16_t>;
+#  endif
+#endif
+    }();
+    return kernel;
+}
+
+// Byte variants of the kernels above, for searching UTF-8 files without decoding them
+#if defined(__SSE2__)
+static qsizetype findBytesSse2(const char *haystack, qsizetype length, const ByteLiteralPattern &p, qsizetype from) {
+    const qsizetype lastStart = length - p.length;
+    const __m128i first0 = _mm_set1_epi8(p.first[0]);
+    const __m128i first1 = _mm_set1_epi8(p.first[1]);
+    const __m128i last0 = _mm_set1_epi8(p.last[0]);
+    const __m128i last1 = _mm_set1_epi8(p.last[1]);
+
+    qsizetype i = from;
+    for (; i + 16 <= lastStart + 1; i += 16) {
+        __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + p.length - 1));
+        __m128i eq = _mm_and_si128(_mm_or_si128(_mm_cmpeq_epi8(f, first0), _mm_cmpeq_epi8(f, first1)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(l, last0), _mm_cmpeq_epi8(l, last1)));
+        quint32 mask = quint32(_mm_movemask_epi8(eq));
+        while (mask) {
+            int lane = qCountTrailingZeroBits(mask);
+            if (literalMatchesAt(haystack + i + lane, p))
+                return i + lane;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralScalar(haystack, length, p, i);
+}
+#endif
+
+#if defined(MACTEXT_HAVE_AVX2_KERNEL)
+__attribute__((target("avx2")))
+static qsizetype findBytesAvx2(const char *haystack, qsizetype length, const ByteLiteralPattern &p, qsizetype from) {
+    const qsizetype lastStart = length - p.length;
+    const __m256i first0 = _mm256_set1_epi8(p.first[0]);
+    const __m256i first1 = _mm256_set1_epi8(p.first[1]);
+    const __m256i last0 = _mm256_set1_epi8(p.last[0]);
+    const __m256i last1 = _mm256_set1_epi8(p.last[1]);
+
+    qsizetype i = from;
+    for (; i + 32 <= lastStart + 1; i += 32) {
+        __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i + p.length - 1));
+        __m256i eq = _mm256_and_si256(_mm256_or_si256(_mm256_cmpeq_epi8(f, first0), _mm256_cmpeq_epi8(f, first1)),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(l, last0), _mm256_cmpeq_epi8(l, last1)));
+        quint32 mask = quint32(_mm256_movemask_epi8(eq));
+        while (mask) {
+            int lane = qCountTrailingZeroBits(mask);
+            if (literalMatchesAt(haystack + i + lane, p))
+                return i + lane;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralScalar(haystack, length, p, i);
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+static qsizetype findBytesNeon(const char *haystack, qsizetype length, const ByteLiteralPattern &p, qsizetype from) {
+    const qsizetype lastStart = length - p.length;
+    const uint8x16_t first0 = vdupq_n_u8(uint8_t(p.first[0]));
+    const uint8x16_t first1 = vdupq_n_u8(uint8_t(p.first[1]));
+    const uint8x16_t last0 = vdupq_n_u8(uint8_t(p.last[0]));
+    const uint8x16_t last1 = vdupq_n_u8(uint8_t(p.last[1]));
+
+    qsizetype i = from;
+    for (; i + 16 <= lastStart + 1; i += 16) {
+        uint8x16_t f = vld1q_u8(reinterpret_cast<const uint8_t *>(haystack + i));
+        uint8x16_t l = vld1q_u8(reinterpret_cast<const uint8_t *>(haystack + i + p.length - 1));
+        uint8x16_t eq = vandq_u8(vorrq_u8(vceqq_u8(f, first0), vceqq_u8(f, first1)),
+                                 vorrq_u8(vceqq_u8(l, last0), vceqq_u8(l, last1)));
+        // Shift-narrow leaves four mask bits per lane in a 64-bit value
+        quint64 mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        while (mask) {
+            int lane = qCountTrailingZeroBits(mask) / 4;
+            if (literalMatchesAt(haystack + i + lane, p))
+                return i + lane;
+            mask &= ~(quint64(0xf) << (lane * 4));
+        }
+    }
+    return findLiteralScalar(haystack, length, p, i);
+}
+#endif
+
+using ByteLiteralKernel = qsizetype (*)(const char *, qsizetype, const ByteLiteralPattern &, qsizetype);
+
+static ByteLiteralKernel byteLiteralKernel() {
+    static const ByteLiteralKernel kernel = []() -> ByteLiteralKernel {
+#if defined(__ARM_NEON) || defined(__aarch64__)
+        return findBytesNeon;
+#else
+#  if defined(MACTEXT_HAVE_AVX2_KERNEL)
+        if (__builtin_cpu_supports("avx2"))
+            return findBytesAvx2;
+#  endif
+#  if defined(__SSE2__)
+        return findBytesSse2;
+#  else
+        return findLiteralScalar<char>;
+#  endif
+#endif
+    }();
+    return kernel;
+}
+
+LiteralSearcher::LiteralSearcher(const QString &needle, Qt::CaseSensitivity sensitivity)
+    : needle(needle), folded(needle), sensitivity(sensitivity) {
+    const bool insensitive = sensitivity == Qt::CaseInsensitive;
+    if (insensitive) {
+        for (QChar c : needle) {
+            if (c.unicode() >= 0x80)
+                useFallback = true;
+        }
+        folded = needle.toLower();
+    }
+    if (useFallback || needle.isEmpty()) {
+        useFallback = true;
+        fallback = QStringMatcher(needle, sensitivity);
+        return;
+    }
+
+    auto otherCase = [insensitive](char16_t c) -> char16_t {
+        return insensitive && c >= 'a' && c <= 'z' ? char16_t(c - ('a' - 'A')) : c;
+    };
+    const char16_t first = folded.front().unicode();
+    const char16_t last = folded.back().unicode();
+    compiled.length = folded.size();
+    compiled.first[0] = first;
+    compiled.first[1] = otherCase(first);
+    compiled.last[0] = last;
+    compiled.last[1] = otherCase(last);
+    compiled.caseInsensitive = insensitive;
+}
+
+qsizetype LiteralSearcher::indexIn(QStringView haystack, qsizetype from) const {
+    if (useFallback)
+        return fallback.indexIn(haystack, from);
+
+    LiteralPattern pattern = compiled;
+    pattern.text = reinterpret_cast<const char16_t *>(folded.utf16());
+    return literalKernel()(haystack.utf16(), haystack.size(), pattern, qMax<qsizetype>(0, from));
+}
+
+ByteLiteralSearcher::ByteLiteralSearcher(const QString &needle, Qt::CaseSensitivity sensitivity,
+                                         QStringConverter::Encoding encoding) {
+    const bool insensitive = sensitivity == Qt::CaseInsensitive;
+    QStringEncoder encoder(encoding, QStringConverter::Flag::Stateless);
+    folded = encoder(needle);
+    if (folded.isEmpty() || encoder.hasError())
+        return;
+    if (insensitive) {
+        for (QChar c : needle) {
+            if (c.unicode() >= 0x80)
+                return;
+        }
+        // The zero halves of UTF-16 ASCII are left alone by the fold
+        folded = folded.toLower();
+    }
+
+    auto otherCase = [insensitive](char c) -> char {
+        return insensitive && c >= 'a' && c <= 'z' ? char(c - ('a' - 'A')) : c;
+    };
+    compiled.length = folded.size();
+    compiled.first[0] = folded.front();
+    compiled.first[1] = otherCase(folded.front());
+    compiled.last[0] = folded.back();
+    compiled.last[1] = otherCase(folded.back());
+    compiled.caseInsensitive = insensitive;
+    valid = true;
+}
+
+qsizetype ByteLiteralSearcher::indexIn(const char *haystack, qsizetype length, qsizetype from) const {
+    if (!valid)
+        return -1;
+
+    ByteLiteralPattern pattern = compiled;
+    pattern.text = folded.constData();
+    return byteLiteralKernel()(haystack, length, pattern, qMax<qsizetype>(0, from));
+}
+
+SearchQuery::SearchQuery(const QString &text, const SearchOptions &options) : pattern(text), flags(options) {
+    const Qt::CaseSensitivity sensitivity = options.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    if (!options.regularExpression) {
+        literal = LiteralSearcher(text, sensitivity);
+        return;
+    }
+
+    QString source = options.wholeWords ? QString("\\b(?:%1)\\b").arg(text) : text;
+    QRegularExpression::PatternOptions patternOptions = QRegularExpression::MultilineOption
+                                                        | QRegularExpression::UseUnicodePropertiesOption;
+    if (!options.caseSensitive)
+        patternOptions |= QRegularExpression::CaseInsensitiveOption;
+    regex = QRegularExpression(source, patternOptions);
+    regex.optimize();
+    // Compiles now, on this thread, rather than in whichever search job matches first
+    valid = regex.isValid();
+}
+
+bool SearchQuery::isWordAt(const QString &haystack, qsizetype position, qsizetype length) const {
+    return ::isWordAt(reinterpret_cast<const char16_t *>(haystack.utf16()), haystack.size(), position, length);
+}
+
+QRegularExpressionMatch SearchQuery::matchAt(const QString &haystack, qsizetype position, qsizetype length) const {
+    if (!flags.regularExpression || !valid)
+        return QRegularExpressionMatch();
+    QRegularExpressionMatch match = regex.match(haystack, position, QRegularExpression::NormalMatch,
+                                                QRegularExpression::AnchorAtOffsetMatchOption);
+    return match.hasMatch() && match.capturedLength() == length ? match : QRegularExpressionMatch();
+}
+
+QString SearchQuery::substitute(const QString &replacement, const QRegularExpressionMatch &match) const {
+    if (!flags.regularExpression)
+        return replacement;
+
+    QString result;
+    result.reserve(replacement.size());
+    for (qsizetype i = 0; i < replacement.size(); ++i) {
+        const QChar c = replacement.at(i);
+        if (c != QLatin1Char('\\') || i + 1 == replacement.size()) {
+            result += c;
+            continue;
+        }
+        const QChar next = replacement.at(++i);
+        if (next.isDigit())
+            result += match.captured(next.digitValue());
+        else if (next == QLatin1Char('n'))
+            result += QLatin1Char('\n');
+        else if (next == QLatin1Char('t'))
+            result += QLatin1Char('\t');
+        else
+            result += next;
+    }
+    return result;
+}
+
+SearchIndex::SearchIndex(QTextDocument *document, QObject *parent)
+    : QObject(parent), document(document), seenRevision(document->revision()) {
+    connect(document, &QTextDocument::contentsChange, this, &SearchIndex::contentsChange);
+}
+
+bool SearchIndex::setQuery(const SearchQuery &query, const QString &content) {
+    current = query;
+    positions.clear();
+    lengths.clear();
+    complete = query.forEachMatch(content, 0, content.size(), QDeadlineTimer(SearchQuery::timeLimitMs),
+                                  [this](qsizetype position, qsizetype length, const QRegularExpressionMatch &) {
+        positions.append(static_cast<int>(position));
+        lengths.append(static_cast<int>(length));
+        return true;
+    });
+    emit changed();
+    return complete;
+}
+
+int SearchIndex::nextMatch(int position) const {
+    auto it = std::lower_bound(positions.cbegin(), positions.cend(), position);
+    return it == positions.cend() ? -1 : static_cast<int>(it - positions.cbegin());
+}
+
+int SearchIndex::previousMatch(int position) const {
+    // Matches don't overlap, so only the last one starting before position can end after it
+    int index = static_cast<int>(std::lower_bound(positions.cbegin(), positions.cend(), position) - positions.cbegin()) - 1;
+    if (index >= 0 && positions.at(index) + lengths.at(index) > position)
+        --index;
+    return index;
+}
+
+void SearchIndex::contentsChange(int position, int charsRemoved, int charsAdded) {
+    // Format-only notifications, e.g. from the highlighter, leave the revision alone
+    const int revision = std::exchange(seenRevision, document->revision());
+    if (charsRemoved == charsAdded && revision == seenRevision)
+        return;
+    if (current.isEmpty() || !current.isValid())
+        return;
+
+    const int delta = charsAdded - charsRemoved;
+
+    // Drop matches overlapping the old span and shift the ones after it
+    int first = static_cast<int>(std::lower_bound(positions.cbegin(), positions.cend(), position) - positions.cbegin());
+    if (first > 0 && positions.at(first - 1) + lengths.at(first - 1) > position)
+        --first;
+    const int last = static_cast<int>(std::lower_bound(positions.cbegin() + first, positions.cend(),
+                                                       position + charsRemoved) - positions.cbegin());
+    int from = qMin(position, first < positions.size() ? positions.at(first) : position);
+    int to = position + charsAdded;
+    if (last > first)
+        to = qMax(to, positions.at(last - 1) + lengths.at(last - 1) + delta);
+    positions.remove(first, last - first);
+    lengths.remove(first, last - first);
+    if (delta != 0) {
+        for (auto it = positions.begin() + first; it != positions.end(); ++it) {
+            *it += delta;
+        }
+    }
+
+    // Rescan the new span with enough context on both sides for matches that straddle it.
+    // A literal can only straddle by its length; a regex, or a query whose word boundaries
+    // depend on the surrounding characters, is rescanned by whole blocks.
+    if (current.options().regularExpression || current.options().wholeWords) {
+        from = document->findBlock(from).position();
+        QTextBlock end = document->findBlock(to);
+        to = end.isValid() ? end.position() + end.length() - 1 : document->characterCount() - 1;
+    } else {
+        from = qMax(0, from - static_cast<int>(current.text().size()) + 1);
+        to = to + static_cast<int>(current.text().size()) - 1;
+    }
+    to = qMin(document->characterCount() - 1, to);
+    if (to <= from) {
+        emit changed();
+        return;
+    }
+
+    QTextCursor cursor(document);
+    cursor.setPosition(from);
+    cursor.setPosition(to, QTextCursor::KeepAnchor);
+    QString window = cursor.selectedText();
+    window.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+
+    // Keep matches non-overlapping, as a full scan would
+    const int previousEnd = first > 0 ? positions.at(first - 1) + lengths.at(first - 1) : 0;
+    const int nextStart = first < positions.size() ? positions.at(first) : INT_MAX;
+    QList<int> foundPositions;
+    QList<int> foundLengths;
+    current.forEachMatch(window, qMax(0, previousEnd - from), window.size(), QDeadlineTimer(SearchQuery::timeLimitMs),
+                         [&](qsizetype pos, qsizetype length, const QRegularExpressionMatch &) {
+        const int start = from + static_cast<int>(pos);
+        if (start + length > nextStart)
+            return false;
+        foundPositions.append(start);
+        foundLengths.append(static_cast<int>(length));
+        return true;
+    });
+
+    if (!foundPositions.isEmpty()) {
+        positions.insert(first, foundPositions.size(), 0);
+        lengths.insert(first, foundLengths.size(), 0);
+        std::copy(foundPositions.cbegin(), foundPositions.cend(), positions.begin() + first);
+        std::copy(foundLengths.cbegin(), foundLengths.cend(), lengths.begin() + first);
+    }
+    emit changed();
+}
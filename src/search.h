@@ -0,0 +1,230 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <QDeadlineTimer>
+#include <QObject>
+#include <QRegularExpression>
+#include <QStringConverter>
+#include <QStringMatcher>
+#include <QTextDocument>
+
+// A needle prepared for the literal search kernels
+template <typename Char>
+struct BasicLiteralPattern {
+    const Char *text;       // lowercased when caseInsensitive
+    qsizetype length;
+    Char first[2];          // accepted first characters (both cases)
+    Char last[2];           // accepted last characters (both cases)
+    bool caseInsensitive;
+};
+using LiteralPattern = BasicLiteralPattern<char16_t>;  // UTF-16 documents
+using ByteLiteralPattern = BasicLiteralPattern<char>;  // UTF-8 files on disk
+
+// Finds a literal string with the fastest available kernel.
+// Case-insensitive search folds ASCII letters; queries containing any other
+// character fall back to QStringMatcher.
+class LiteralSearcher {
+public:
+    LiteralSearcher() = default;
+    LiteralSearcher(const QString &needle, Qt::CaseSensitivity sensitivity);
+
+    qsizetype indexIn(QStringView haystack, qsizetype from = 0) const;
+    QString pattern() const { return needle; }
+    Qt::CaseSensitivity caseSensitivity() const { return sensitivity; }
+
+private:
+    QString needle;
+    QString folded;
+    Qt::CaseSensitivity sensitivity = Qt::CaseSensitive;
+    LiteralPattern compiled = {};
+    QStringMatcher fallback;
+    bool useFallback = false;
+};
+
+// Byte literal searcher
+// The UTF-8 counterpart of LiteralSearcher, for scanning files straight from a mapping.
+// Only ASCII is folded here, so a case-insensitive needle with other characters is not
+// valid and the caller has to decode the file and use LiteralSearcher instead. Other
+// encodings are searched for the needle's bytes in that encoding; a needle the encoding
+// can't hold is not valid either.
+class ByteLiteralSearcher {
+public:
+    ByteLiteralSearcher() = default;
+    ByteLiteralSearcher(const QString &needle, Qt::CaseSensitivity sensitivity,
+                        QStringConverter::Encoding encoding = QStringConverter::Utf8);
+
+    bool isValid() const { return valid; }
+    qsizetype size() const { return folded.size(); }
+    qsizetype indexIn(const char *haystack, qsizetype length, qsizetype from = 0) const;
+
+private:
+    QByteArray folded;
+    ByteLiteralPattern compiled = {};
+    bool valid = false;
+};
+
+inline bool isWordChar(char c) {
+    const char lower = char(c | 0x20);
+    return uchar(c) >= 0x80 || (c >= '0' && c <= '9') || (lower >= 'a' && lower <= 'z') || c == '_';
+}
+
+inline bool isWordChar(char16_t c) {
+    if (c < 0x80)
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    return QChar::isLetterOrNumber(c);
+}
+
+// Whole-word test for a match of length at pos. In UTF-8 data every byte of a multi-byte
+// character counts as a word character, which treats non-ASCII text as letters.
+template <typename Char>
+inline bool isWordAt(const Char *data, qsizetype size, qsizetype pos, qsizetype length) {
+    return (pos == 0 || !isWordChar(data[pos - 1])) && (pos + length >= size || !isWordChar(data[pos + length]));
+}
+
+// Search query
+// What the find dialog looks for: literal text or a regular expression, optionally case
+// sensitive and restricted to whole words. The pattern is compiled and JIT-optimized once,
+// when the query is built, and the same query is shared by find, replace, replace all and
+// find in tabs. Literal queries keep using LiteralSearcher.
+struct SearchOptions {
+    bool caseSensitive = false;
+    bool wholeWords = false;
+    bool regularExpression = false;
+
+    bool operator==(const SearchOptions &other) const {
+        return caseSensitive == other.caseSensitive && wholeWords == other.wholeWords
+               && regularExpression == other.regularExpression;
+    }
+    bool operator!=(const SearchOptions &other) const { return !(*this == other); }
+};
+
+class SearchQuery {
+public:
+    // A regex scan of a whole document on the GUI thread gives up after this long
+    static const int timeLimitMs = 2000;
+
+    SearchQuery() = default;
+    SearchQuery(const QString &text, const SearchOptions &options);
+
+    QString text() const { return pattern; }
+    SearchOptions options() const { return flags; }
+    bool isEmpty() const { return pattern.isEmpty(); }
+    // False for a regular expression that doesn't compile
+    bool isValid() const { return valid; }
+    QString errorString() const { return regex.errorString(); }
+    bool isSameQuery(const QString &text, const SearchOptions &options) const {
+        return pattern == text && flags == options;
+    }
+    // Characters of context past a chunk of text needed to find matches starting inside it
+    qsizetype lookahead() const { return flags.regularExpression ? 4096 : qMax<qsizetype>(0, pattern.size() - 1); }
+
+    // Calls found(position, length, match) for every match starting in [from, to) until it
+    // returns false. Empty matches are skipped and matches don't overlap. match holds the
+    // capture groups in regex mode. Returns false if the deadline passed before to was reached,
+    // also when it passed during a single slow match.
+    template <typename Found>
+    bool forEachMatch(const QString &haystack, qsizetype from, qsizetype to, QDeadlineTimer deadline,
+                      Found found) const;
+    // Same as above but only for a match starting exactly at position
+    QRegularExpressionMatch matchAt(const QString &haystack, qsizetype position, qsizetype length) const;
+    // Expands \0 to \9 to capture groups and \n and \t in regex mode; literal queries
+    // insert the replacement as it is
+    QString substitute(const QString &replacement, const QRegularExpressionMatch &match) const;
+
+private:
+    bool isWordAt(const QString &haystack, qsizetype position, qsizetype length) const;
+
+    QString pattern;
+    SearchOptions flags;
+    LiteralSearcher literal;
+    QRegularExpression regex;
+    bool valid = true;
+};
+
+template <typename Found>
+bool SearchQuery::forEachMatch(const QString &haystack, qsizetype from, qsizetype to, QDeadlineTimer deadline,
+                               Found found) const {
+    if (pattern.isEmpty() || !valid)
+        return true;
+    to = qMin(to, haystack.size());
+
+    if (!flags.regularExpression) {
+        const qsizetype length = pattern.size();
+        for (qsizetype pos = literal.indexIn(haystack, from); pos != -1 && pos < to;
+             pos = literal.indexIn(haystack, pos)) {
+            if (flags.wholeWords && !isWordAt(haystack, pos, length)) {
+                ++pos;
+                continue;
+            }
+            if (!found(pos, length, QRegularExpressionMatch()))
+                return true;
+            pos += length;
+        }
+        return true;
+    }
+
+    // Matching at an offset of the whole haystack keeps lookbehinds and anchors right
+    qsizetype pos = from;
+    while (pos < to) {
+        const QRegularExpressionMatch match = regex.match(haystack, pos);
+        // Checked after matching, so one backtracking-heavy match still counts as running out of time
+        if (deadline.hasExpired())
+            return false;
+        if (!match.hasMatch() || match.capturedStart() >= to)
+            break;
+        if (match.capturedLength() == 0) {
+            pos = match.capturedStart() + 1;
+            continue;
+        }
+        if (!found(match.capturedStart(), match.capturedLength(), match))
+            break;
+        pos = match.capturedEnd();
+    }
+    return true;
+}
+
+// Search index
+// Sorted start positions and lengths of every match of one query in a document. It
+// follows contentsChange, rescanning only the changed span, so stepping to the next or
+// previous match is a binary search and the match count is always at hand. Regex matches
+// vary in length, so for them the rescan widens to the whole blocks around the change.
+class SearchIndex : public QObject {
+    Q_OBJECT
+
+public:
+    SearchIndex(QTextDocument *document, QObject *parent = nullptr);
+
+    // Rebuilds the index for query from content, the document's current plain text.
+    // Returns false if a regex scan ran out of time and the index is incomplete.
+    bool setQuery(const SearchQuery &query, const QString &content);
+    const SearchQuery &query() const { return current; }
+    bool isComplete() const { return complete; }
+    qint64 bytes() const { return qint64(positions.capacity() + lengths.capacity()) * qint64(sizeof(int)); }
+
+    int count() const { return positions.size(); }
+    int matchLength(int index) const { return lengths.at(index); }
+    int matchPosition(int index) const { return positions.at(index); }
+    const QList<int> &matchPositions() const { return positions; }
+
+    // Index of the first match starting at or after position, or -1
+    int nextMatch(int position) const;
+    // Index of the last match ending at or before position, or -1
+    int previousMatch(int position) const;
+
+signals:
+    // The set of matches may have changed
+    void changed();
+
+private slots:
+    void contentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    QTextDocument *document;
+    SearchQuery current;
+    bool complete = true;
+    QList<int> positions;
+    QList<int> lengths;     // Of the match at the same index
+    int seenRevision = 0;   // Document revision as of the last change seen
+};
+
+#endif // SEARCH_H
@@ -0,0 +1,12 @@
+# Links the editor library into the app and the benchmarks
+QT += widgets core
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+win32:CONFIG(release, debug|release): MACTEXT_LIB_DIR = $$OUT_PWD/../src/release
+else:win32:CONFIG(debug, debug|release): MACTEXT_LIB_DIR = $$OUT_PWD/../src/debug
+else: MACTEXT_LIB_DIR = $$OUT_PWD/../src
+
+LIBS += -L$$MACTEXT_LIB_DIR -lmactext
+win32-msvc*: PRE_TARGETDEPS += $$MACTEXT_LIB_DIR/mactext.lib
+else: PRE_TARGETDEPS += $$MACTEXT_LIB_DIR/libmactext.a
@@ -0,0 +1,36 @@
+TEMPLATE = lib
+CONFIG += staticlib
+TARGET = mactext
+QT += widgets core
+
+HEADERS       = codeeditor.h \
+                editjournal.h \
+                findreplacedialog.h \
+                foldersearch.h \
+                gutter.h \
+                hibernatedtab.h \
+                highlighter.h \
+                jobs.h \
+                largefileviewer.h \
+                mainwindow.h \
+                minimap.h \
+                perf.h \
+                performancepanel.h \
+                piecetable.h \
+                search.h \
+                textformat.h
+SOURCES       = codeeditor.cpp \
+                editjournal.cpp \
+                findreplacedialog.cpp \
+                foldersearch.cpp \
+                gutter.cpp \
+                highlighter.cpp \
+                jobs.cpp \
+                largefileviewer.cpp \
+                mainwindow.cpp \
+                minimap.cpp \
+                perf.cpp \
+                performancepanel.cpp \
+                piecetable.cpp \
+                search.cpp \
+                textformat.cpp
@@ -0,0 +1,86 @@
+#include "textformat.h"
+
+#if defined(__SSE2__) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+bool isValidUtf8(const char *data, qint64 size, bool *ascii, qint64 *validLength) {
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    const uchar *end = p + size;
+    *ascii = true;
+    if (validLength)
+        *validLength = size;
+    while (p < end) {
+#if defined(__SSE2__)
+        while (end - p >= 16 && _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))) == 0)
+            p += 16;
+#elif defined(__aarch64__)
+        // vmaxvq_u8 is AArch64 only; 32-bit ARM takes the byte loop below
+        while (end - p >= 16 && vmaxvq_u8(vld1q_u8(p)) < 0x80)
+            p += 16;
+#endif
+        if (p == end)
+            break;
+        if (*p < 0x80) {
+            ++p;
+            continue;
+        }
+
+        *ascii = false;
+        int length;
+        uint codePoint;
+        if ((*p & 0xe0) == 0xc0) {
+            length = 2;
+            codePoint = *p & 0x1f;
+        } else if ((*p & 0xf0) == 0xe0) {
+            length = 3;
+            codePoint = *p & 0x0f;
+        } else if ((*p & 0xf8) == 0xf0) {
+            length = 4;
+            codePoint = *p & 0x07;
+        } else {
+            return false;
+        }
+        if (end - p < length) {
+            if (!validLength)
+                return false;
+            *validLength = p - reinterpret_cast<const uchar *>(data);
+            return true;
+        }
+        for (int i = 1; i < length; ++i) {
+            if ((p[i] & 0xc0) != 0x80)
+                return false;
+            codePoint = (codePoint << 6) | (p[i] & 0x3f);
+        }
+        static const uint minimum[5] = {0, 0, 0x80, 0x800, 0x10000};
+        if (codePoint < minimum[length] || codePoint > 0x10ffff || (codePoint >= 0xd800 && codePoint <= 0xdfff))
+            return false;
+        p += length;
+    }
+    return true;
+}
+
+TextFormat detectByteOrderMark(const char *data, qint64 size) {
+    TextFormat format;
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+    if (size >= 3 && bytes[0] == 0xef && bytes[1] == 0xbb && bytes[2] == 0xbf) {
+        format.byteOrderMark = true;
+    } else if (size >= 2 && bytes[0] == 0xff && bytes[1] == 0xfe) {
+        format.encoding = QStringConverter::Utf16LE;
+        format.byteOrderMark = true;
+    } else if (size >= 2 && bytes[0] == 0xfe && bytes[1] == 0xff) {
+        format.encoding = QStringConverter::Utf16BE;
+        format.byteOrderMark = true;
+    }
+    return format;
+}
+
+TextFormat detectTextFormat(const char *data, qint64 size) {
+    TextFormat format = detectByteOrderMark(data, size);
+    if (!format.byteOrderMark && !isValidUtf8(data, size, &format.ascii))
+        format.encoding = QStringConverter::Latin1;
+    return format;
+}
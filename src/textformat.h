@@ -0,0 +1,30 @@
+#ifndef TEXTFORMAT_H
+#define TEXTFORMAT_H
+
+#include <QMetaType>
+#include <QStringConverter>
+
+// Text encodings
+// How a file is stored on disk. Tabs keep it in their textFormat property so a save
+// writes the same encoding, byte order mark and line endings back.
+struct TextFormat {
+    QStringConverter::Encoding encoding = QStringConverter::Utf8;
+    bool byteOrderMark = false;
+    bool crlf = false;
+    bool ascii = false;     // Valid UTF-8 without any byte above 0x7f
+};
+Q_DECLARE_METATYPE(TextFormat)
+
+// Checks 16 bytes at a time for a set high bit and only walks multi-byte sequences one
+// by one, so ASCII stretches validate at memory speed. Overlong forms, surrogates and
+// code points past U+10FFFF are rejected. With validLength, a sequence cut off by the end
+// of the data isn't an error; validLength is set to the length before it.
+bool isValidUtf8(const char *data, qint64 size, bool *ascii, qint64 *validLength = nullptr);
+
+// Picks the encoding from a byte order mark, or UTF-8 when there is none
+TextFormat detectByteOrderMark(const char *data, qint64 size);
+
+// Picks the encoding from a byte order mark, else UTF-8 if the bytes validate, else Latin-1
+TextFormat detectTextFormat(const char *data, qint64 size);
+
+#endif // TEXTFORMAT_H